@@ -6,6 +6,7 @@ import logging
 import os
 from pathlib import Path
 import shutil
+import sys
 from tempfile import TemporaryDirectory
 from threading import RLock
 
@@ -33,14 +34,40 @@ MathTextParser._backend_mapping["mplcairo"] = \
     _mplcairo.MathtextBackendCairo
 
 
+def _get_draw_lock(owner):
+    """
+    Return the lock to hold while drawing a figure onto *owner*'s renderer.
+
+    This is the global `_LOCK`, unless the ``release_gil`` option is set, in
+    which case each *owner* (a canvas or a `.MultiPage`) gets its own lock, so
+    that independent figures can be drawn concurrently.  Text rendering always
+    goes through `_LOCK` (see `_with_lock`).
+    """
+    if not _mplcairo.get_options()["release_gil"]:
+        return _LOCK
+    try:
+        return vars(owner)["_draw_lock"]
+    except KeyError:
+        return vars(owner).setdefault("_draw_lock", RLock())
+
+
+def _with_lock(func):
+    """Wrap *func* (which may call into FreeType) to run under `_LOCK`."""
+    @functools.wraps(func)
+    def wrapper(*args, **kwargs):
+        with _LOCK:
+            return func(*args, **kwargs)
+    return wrapper
+
+
 @functools.lru_cache(1)
 def _get_tex_font_map():
     return dviread.PsfontsMap(dviread.find_tex_file("pdftex.map"))
 
 
-def _get_drawn_subarray_and_bounds(img):
+def _get_drawn_subarray_and_bounds(img, alpha_index=3):
     """Return the drawn region of a buffer and its ``(l, b, w, h)`` bounds."""
-    drawn = img[..., 3] != 0
+    drawn = img[..., alpha_index] != 0
     x_nz, = drawn.any(axis=0).nonzero()
     y_nz, = drawn.any(axis=1).nonzero()
     if len(x_nz) and len(y_nz):
@@ -88,6 +115,8 @@ class GraphicsContextRendererCairo(
     _for_svg_output = partialmethod(_for_fmt_output, _StreamSurfaceType.SVG)
     _for_script_output = partialmethod(
         _for_fmt_output, _StreamSurfaceType.Script)
+    _for_recording_output = partialmethod(
+        _for_fmt_output, _StreamSurfaceType.Recording, None)
 
     @classmethod
     def _for_svgz_output(cls, stream, width, height, dpi):
@@ -107,11 +136,17 @@ class GraphicsContextRendererCairo(
         obj._finish = _finish
         return obj
 
+    draw_text = _with_lock(_mplcairo.GraphicsContextRendererCairo.draw_text)
+    draw_texts = _with_lock(_mplcairo.GraphicsContextRendererCairo.draw_texts)
+    get_text_width_height_descent = _with_lock(
+        _mplcairo.GraphicsContextRendererCairo.get_text_width_height_descent)
+
     def option_image_nocomposite(self):
         return (not mpl.rcParams["image.composite_image"]
                 if self._has_vector_surface() else True)
 
     # Based on the backend_pdf implementation.
+    @_with_lock
     def draw_tex(self, gc, x, y, s, prop, angle, ismath="TeX!", mtext=None):
         fontsize = prop.get_size_in_points()
         dvifile = self.get_texmanager().make_dvi(s, fontsize)
@@ -145,13 +180,17 @@ class GraphicsContextRendererCairo(
 
     start_rasterizing = _mplcairo.GraphicsContextRendererCairo.start_filter
 
-    # While we could just write
-    #   stop_rasterizing = partialmethod(stop_filter,
-    #                                    lambda img, dpi: (img, 0, 0))
-    # this crashes inspect.signature on Py3.6
-    # (https://bugs.python.org/issue33009).
     def stop_rasterizing(self):
-        return self.stop_filter(lambda img, dpi: (img, 0, 0))
+        # No filter to apply: paint the drawn region of the native buffer
+        # directly, without converting it to straight RGBA and back.
+        buf = self._stop_filter_get_buffer()
+        # In native-endian ARGB32, alpha is the most significant byte.
+        alpha_index = (
+            0 if buf.dtype == np.uint8 and sys.byteorder == "big" else 3)
+        _, (l, b, w, h) = _get_drawn_subarray_and_bounds(buf, alpha_index)
+        if not (w and h):
+            return
+        self._draw_cairo_buffer(self, l, b, buf[b:b+h, l:l+w])
 
     # "Undocumented" APIs needed to patch Agg.
 
@@ -198,14 +237,14 @@ class FigureCanvasCairo(FigureCanvasBase):
                 # Text._get_layout cache.
                 last_renderer.clear()
                 if _ensure_drawn:
-                    with _LOCK:
+                    with _get_draw_lock(self):
                         self.figure.draw(last_renderer)
             return last_renderer
         else:
             renderer = func(*args, **kwargs)
             self._last_renderer_call = (func, args, kwargs), renderer
             if _ensure_drawn:
-                with _LOCK:
+                with _get_draw_lock(self):
                     self.figure.draw(renderer)
             return renderer
 
@@ -225,8 +264,24 @@ class FigureCanvasCairo(FigureCanvasBase):
     def copy_from_bbox(self, bbox):
         return self.get_renderer(_ensure_drawn=True).copy_from_bbox(bbox)
 
+    def _get_buffer_rect(self, bbox):
+        """
+        Return the ``(x, y, width, height)`` rectangle of pixels (counted from
+        the top left corner) covering *bbox* (in display coordinates), or the
+        full canvas if *bbox* is None, clipped to the canvas.
+        """
+        width, height = self.figure.bbox.size
+        if bbox is None:
+            return 0, 0, int(np.ceil(width)), int(np.ceil(height))
+        x0, y0, x1, y1 = bbox.extents
+        l = int(max(np.floor(x0), 0))
+        t = int(max(np.floor(height - y1), 0))
+        r = int(min(np.ceil(x1), np.ceil(width)))
+        b = int(min(np.ceil(height - y0), np.ceil(height)))
+        return l, t, max(r - l, 0), max(b - t, 0)
+
     def restore_region(self, region):
-        with _LOCK:
+        with _get_draw_lock(self):
             self.get_renderer().restore_region(region)
         super().draw()
 
@@ -248,7 +303,7 @@ class FigureCanvasCairo(FigureCanvasBase):
             renderer = renderer_factory(
                 stream, self.figure.bbox.width, self.figure.bbox.height, dpi)
             renderer._set_metadata(metadata)
-            with _LOCK:
+            with _get_draw_lock(self):
                 self.figure.draw(renderer)
             # _finish() corresponds finalize() in Matplotlib's PDF and SVG
             # backends; it is inlined in Matplotlib's PS backend.
@@ -308,15 +363,19 @@ class FigureCanvasCairo(FigureCanvasBase):
     print_ps = partialmethod(_print_ps_impl, False)
     print_eps = partialmethod(_print_ps_impl, True)
 
-    def _get_fresh_straight_rgba8888(self):
+    def _get_fresh_renderer(self):
         # Swap out the cache, as savefig may be playing with the background
         # color.
         last_renderer_call = self._last_renderer_call
         self._last_renderer_call = (None, None)
-        with _LOCK:
+        with _get_draw_lock(self):
             renderer = self.get_renderer(_ensure_drawn=True)
         self._last_renderer_call = last_renderer_call
-        return _util.cairo_to_straight_rgba8888(renderer._get_buffer())
+        return renderer
+
+    def _get_fresh_straight_rgba8888(self):
+        return _util.cairo_to_straight_rgba8888(
+            self._get_fresh_renderer()._get_buffer())
 
     def print_rgba(self, path_or_stream, *,
                    dryrun=False, metadata=None, **kwargs):
@@ -332,9 +391,6 @@ class FigureCanvasCairo(FigureCanvasBase):
     def print_png(self, path_or_stream, *,
                   dryrun=False, metadata=None, pil_kwargs=None, **kwargs):
         _check_print_extra_kwargs(**kwargs)
-        img = self._get_fresh_straight_rgba8888()
-        if dryrun:
-            return
         metadata = {
             "Software":
             f"matplotlib version {mpl.__version__}, https://matplotlib.org",
@@ -342,6 +398,23 @@ class FigureCanvasCairo(FigureCanvasBase):
         }
         if pil_kwargs is None:
             pil_kwargs = {}
+        # Use our own, streaming, encoder, unless PIL-specific options are
+        # passed.
+        if pil_kwargs.keys() <= {"compress_level", "optimize", "dpi"}:
+            renderer = self._get_fresh_renderer()
+            if dryrun:
+                return
+            with cbook.open_file_cm(path_or_stream, "wb") as stream:
+                renderer._write_png(
+                    stream, metadata,
+                    pil_kwargs.get("dpi", (self.figure.dpi, self.figure.dpi)),
+                    compress_level=(
+                        9 if pil_kwargs.get("optimize") else
+                        pil_kwargs.get("compress_level", 6)))
+            return
+        img = self._get_fresh_straight_rgba8888()
+        if dryrun:
+            return
         # Only use the metadata kwarg if pnginfo is not set, because the
         # semantics of duplicate keys in pnginfo is unclear.
         if "pnginfo" not in pil_kwargs:
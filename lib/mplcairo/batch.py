@@ -0,0 +1,59 @@
+from concurrent.futures import ThreadPoolExecutor
+from pathlib import Path
+
+from matplotlib import rcParams
+
+from .base import FigureCanvasCairo
+
+
+def render_many(figures, formats, outputs, *, threads=0, **kwargs):
+    """
+    Save many figures, possibly concurrently.
+
+    Each figure of *figures* is saved to the matching entry of *outputs* (a
+    path or a binary file-like), in the matching entry of *formats*.  *formats*
+    may also be a single format (for all figures), and a None format is
+    inferred from the output's extension, defaulting to
+    :rc:`savefig.format`.  Additional *kwargs* (e.g. *metadata*) are passed to
+    the canvases' ``print_<format>`` methods.
+
+    If *threads* is positive, figures are saved by a pool of *threads* worker
+    threads, each picking the next pending figure when done with the previous
+    one.  Figures can only be drawn in parallel if the ``release_gil`` option
+    is set (see `mplcairo.set_options`): the traversal of the artists remains
+    serialized by the GIL, but cairo's rasterization and the encoding of the
+    outputs then overlap across figures.  Figures must not be modified (nor
+    closed) until `render_many` returns.
+
+    Unlike `.Figure.savefig`, figures are printed directly by their canvas
+    (which is replaced by a `.FigureCanvasCairo`), without going through the
+    (thread-unsafe) temporary rcParams and figure property changes that
+    implement *bbox_inches*, *facecolor*, etc.  The first error encountered (in
+    the order of *figures*) is reraised once all figures are done.
+    """
+    figures = list(figures)
+    outputs = list(outputs)
+    if isinstance(formats, str) or formats is None:
+        formats = [formats] * len(figures)
+    else:
+        formats = list(formats)
+    if not len(figures) == len(formats) == len(outputs):
+        raise ValueError(
+            "figures, formats and outputs must have the same length")
+
+    def render(figure, fmt, output):
+        if fmt is None:
+            fmt = (isinstance(output, (str, Path)) and Path(output).suffix[1:]
+                   or rcParams["savefig.format"])
+        canvas = FigureCanvasCairo(figure)
+        getattr(canvas, f"print_{fmt.lower()}")(output, **kwargs)
+
+    if threads > 0:
+        with ThreadPoolExecutor(threads) as executor:
+            futures = [executor.submit(render, *args)
+                       for args in zip(figures, formats, outputs)]
+        for future in futures:
+            future.result()
+    else:
+        for figure, fmt, output in zip(figures, formats, outputs):
+            render(figure, fmt, output)
@@ -1,7 +1,8 @@
+import math
+
 import cairo
 from matplotlib.backends.backend_gtk3 import _BackendGTK3, FigureCanvasGTK3
 
-from . import _util
 from .base import FigureCanvasCairo
 
 
@@ -10,20 +11,26 @@ class FigureCanvasGTKCairo(FigureCanvasCairo, FigureCanvasGTK3):
         pass
 
     def on_draw_event(self, widget, ctx):
-        # We always repaint the full canvas (doing otherwise would require an
-        # additional copy of the buffer into a contiguous block, so it's not
-        # clear it would be faster).
-        buf = _util.cairo_to_premultiplied_argb32(
-            self.get_renderer(_ensure_drawn=True)._get_buffer())
-        height, width, _ = buf.shape
-        image = cairo.ImageSurface.create_for_data(
-            buf, cairo.FORMAT_ARGB32, width, height)
-        ctx.set_source_surface(image, 0, 0)
-        ctx.paint()
+        renderer = self.get_renderer(_ensure_drawn=True)
+        # Only convert and paint the region to be repainted (ctx is already
+        # clipped to it).  If it spans the full width of an ARGB32 surface
+        # (e.g., on full repaints), the buffer is directly a view into the
+        # surface.
+        x0, y0, x1, y1 = ctx.clip_extents()
+        l, t = math.floor(x0), math.floor(y0)
+        r, b = math.ceil(x1), math.ceil(y1)
+        for x, y, buf in renderer._get_damaged_buffers(
+                "premultiplied_argb32", [(l, t, r - l, b - t)]):
+            height, width, _ = buf.shape
+            image = cairo.ImageSurface.create_for_data(
+                buf, cairo.FORMAT_ARGB32, width, height)
+            ctx.set_source_surface(image, x, y)
+            ctx.paint()
 
     def blit(self, bbox=None):  # FIXME: flickering.
         super().blit(bbox=bbox)
-        self.queue_draw()
+        # Only the blitted region needs to be repainted.
+        self.queue_draw_area(*self._get_buffer_rect(bbox))
 
 
 @_BackendGTK3.export
@@ -0,0 +1,78 @@
+import numpy as np
+
+from matplotlib import artist, colors as mcolors
+from matplotlib.image import AxesImage
+from matplotlib.transforms import Affine2D, Bbox, BboxTransform
+
+
+class ColormappedImage(AxesImage):
+    """
+    An `.AxesImage` that leaves colormapping and resampling to the renderer.
+
+    With mplcairo, 2D data with a linear, non-clipping `.Normalize`, a scalar
+    alpha and "nearest" or "bilinear" interpolation is colormapped,
+    premultiplied and resampled natively, in a single pass, by the renderer's
+    ``draw_colormapped_image``, instead of first being resampled and converted
+    to a full-resolution RGBA array in Python.  In all other cases (including
+    with other renderers), this draws like a plain `.AxesImage`.
+
+    Usage is e.g.::
+
+        im = ColormappedImage(ax, cmap="viridis", interpolation="nearest")
+        im.set_data(data)
+        ax.add_image(im)
+    """
+
+    def _can_draw_colormapped(self, renderer):
+        A = self.get_array()
+        return (hasattr(renderer, "draw_colormapped_image")
+                and A is not None and A.ndim == 2 and A.size
+                and self.get_interpolation() in ["nearest", "bilinear"]
+                and type(self.norm) is mcolors.Normalize
+                and not self.norm.clip
+                and np.ndim(self.get_alpha()) == 0
+                and self.get_transform().is_affine)
+
+    def draw(self, renderer, *args, **kwargs):
+        # AxesImage.draw is already wrapped by allow_rasterization, so only the
+        # native path is wrapped here, lest agg_filter be applied twice.
+        if not self._can_draw_colormapped(renderer):
+            return super().draw(renderer, *args, **kwargs)
+        return self._draw_colormapped(renderer)
+
+    @artist.allow_rasterization
+    def _draw_colormapped(self, renderer):
+        if not self.get_visible():
+            self.stale = False
+            return
+        A = self.get_array()
+        data = np.ma.getdata(A)
+        if data.dtype not in [np.float32, np.float64]:
+            data = data.astype(float)
+        if np.ma.is_masked(A):
+            data = np.where(np.ma.getmaskarray(A), np.nan, data)
+        self.norm.autoscale_None(A)
+        cmap = self.cmap
+        if not cmap._isinit:
+            cmap._init()
+        # As in Colormap.__call__(..., bytes=True).
+        lut = (cmap._lut * 255).astype(np.uint8)
+        rows, cols = data.shape
+        l, r, b, t = self.get_extent()
+        # Map the (column, row) index space of the data to its extent, with
+        # the first row at the top for origin="upper".
+        transform = (
+            (Affine2D().scale(1, -1).translate(0, rows)
+             if self.origin == "upper" else Affine2D())
+            + BboxTransform(Bbox.from_bounds(0, 0, cols, rows),
+                            Bbox.from_extents(l, b, r, t))
+            + self.get_transform())
+        gc = renderer.new_gc()
+        self._set_gc_clip(gc)
+        gc.set_alpha(self.get_alpha())
+        gc.set_url(self.get_url())
+        renderer.draw_colormapped_image(
+            gc, data, lut, self.norm.vmin, self.norm.vmax, transform,
+            self.get_interpolation())
+        gc.restore()
+        self.stale = False
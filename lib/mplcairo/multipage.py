@@ -1,10 +1,12 @@
+from collections import deque
+from concurrent.futures import ThreadPoolExecutor
 from contextlib import ExitStack
 import copy
 from pathlib import Path
 
 from matplotlib import cbook, rcParams
 
-from .base import GraphicsContextRendererCairo, _LOCK
+from .base import GraphicsContextRendererCairo, _get_draw_lock
 
 
 class MultiPage:
@@ -20,11 +22,22 @@ class MultiPage:
     Note that the only other method of `PdfPages` that is implemented is
     `close`, and that empty files are not created -- as if the *keep_empty*
     argument to `PdfPages` was always False.
+
+    If *n_threads* is positive, each page is drawn into a recording surface in
+    a pool of *n_threads* worker threads, and the pages are then replayed into
+    the output in order.  In that case, `savefig` returns before the figure is
+    drawn, so figures must not be modified (nor closed) until `close` returns
+    (save distinct figures rather than a single one modified in between).
+    Drawing can only proceed in parallel if the ``release_gil`` option is set
+    (see `mplcairo.set_options`).
     """
 
-    def __init__(self, path_or_stream=None, format=None, *, metadata=None):
+    def __init__(self, path_or_stream=None, format=None, *, metadata=None,
+                 n_threads=0):
         self._stack = ExitStack()
         self._renderer = None
+        self._executor = None
+        self._pending = deque()
 
         def _make_renderer():
             stream = self._stack.enter_context(
@@ -39,20 +52,44 @@ class MultiPage:
             self._renderer = renderer_cls(stream, 1, 1, 1)
             self._stack.callback(self._renderer._finish)
             self._renderer._set_metadata(copy.copy(metadata))
+            if n_threads > 0:
+                self._executor = self._stack.enter_context(
+                    ThreadPoolExecutor(n_threads))
+                # Registered last, so that it runs first on close().
+                self._stack.callback(self._replay_pending, wait=True)
 
         self._make_renderer = _make_renderer
 
+    def _replay_pending(self, *, wait=False):
+        # Replay, in order, the pages that are done drawing (or all of them).
+        while self._pending and (wait or self._pending[0][0].done()):
+            future, size = self._pending.popleft()
+            self._renderer._set_size(*size)
+            self._renderer._replay_page(future.result())
+
     def savefig(self, figure, **kwargs):
         # FIXME[Upstream]: Not all kwargs are supported here -- but I plan to
         # deprecate them upstream.
         if self._renderer is None:
             self._make_renderer()
         figure.set_dpi(72)
-        self._renderer._set_size(*figure.canvas.get_width_height(),
-                                 kwargs.get("dpi", 72))
-        with _LOCK:
-            figure.draw(self._renderer)
-        self._renderer._show_page()
+        size = (*figure.canvas.get_width_height(), kwargs.get("dpi", 72))
+        if self._executor is None:
+            self._renderer._set_size(*size)
+            with _get_draw_lock(self):
+                figure.draw(self._renderer)
+            self._renderer._show_page()
+        else:
+            page = GraphicsContextRendererCairo._for_recording_output(*size)
+            page._set_size(*size)
+
+            def draw():
+                with _get_draw_lock(figure):
+                    figure.draw(page)
+                return page
+
+            self._pending.append((self._executor.submit(draw), size))
+            self._replay_pending()
 
     def close(self):
         return self._stack.__exit__(None, None, None)
@@ -1,7 +1,9 @@
 import ctypes
+import math
 
 from matplotlib.backends import qt_compat
-from matplotlib.backends.backend_qt5 import QtGui, _BackendQT5, FigureCanvasQT
+from matplotlib.backends.backend_qt5 import (
+    QtCore, QtGui, _BackendQT5, FigureCanvasQT)
 
 from . import _util
 from .base import FigureCanvasCairo
@@ -11,38 +13,55 @@ class FigureCanvasQTCairo(FigureCanvasCairo, FigureCanvasQT):
     def paintEvent(self, event):
         if self._update_dpi():
             return
-        # We always repaint the full canvas (doing otherwise would require an
-        # additional copy of the buffer into a contiguous block, so it's not
-        # clear it would be faster).
-        buf = _util.cairo_to_premultiplied_argb32(
-            self.get_renderer(_ensure_drawn=True)._get_buffer())
-        height, width, _ = buf.shape
-        # The image buffer is not necessarily contiguous, but the padding
-        # in the ARGB32 case (each scanline is 32-bit aligned) happens to
-        # match what QImage requires; in the RGBA128F case the documented Qt
-        # requirement does not seem necessary?
-        qimage = QtGui.QImage(buf, width, height,
-                              QtGui.QImage.Format_ARGB32_Premultiplied)
-        try:
-            qimage_setDevicePixelRatioF = qimage.setDevicePixelRatioF
-        except AttributeError:
+        renderer = self.get_renderer(_ensure_drawn=True)
+        # Only convert and paint the region to be repainted, in (physical)
+        # pixels.  If it spans the full width of an ARGB32 surface (e.g., on
+        # full repaints), the buffer is directly a view into the surface.
+        ratio = self._dpi_ratio
+        rect = event.rect()
+        l = math.floor(rect.left() * ratio)
+        t = math.floor(rect.top() * ratio)
+        r = math.ceil((rect.right() + 1) * ratio)
+        b = math.ceil((rect.bottom() + 1) * ratio)
+        painter = QtGui.QPainter(self)
+        painter.eraseRect(rect)
+        for x, y, buf in renderer._get_damaged_buffers(
+                "premultiplied_argb32", [(l, t, r - l, b - t)]):
+            height, width, _ = buf.shape
+            # The buffers are contiguous, which matches what QImage requires
+            # (each scanline is 32-bit aligned).
+            qimage = QtGui.QImage(buf, width, height,
+                                  QtGui.QImage.Format_ARGB32_Premultiplied)
             try:
-                qimage_setDevicePixelRatioF = qimage.setDevicePixelRatio
+                qimage_setDevicePixelRatioF = qimage.setDevicePixelRatioF
             except AttributeError:
-                def qimage_setDevicePixelRatioF(scaleFactor): pass
-        qimage_setDevicePixelRatioF(self._dpi_ratio)
-        # FIXME[PySide{,2}]: https://bugreports.qt.io/browse/PYSIDE-140
-        if qt_compat.QT_API.startswith("PySide"):
-            ctypes.c_long.from_address(id(buf)).value -= 1
-        painter = QtGui.QPainter(self)
-        painter.eraseRect(self.rect())
-        painter.drawImage(0, 0, qimage)
+                try:
+                    qimage_setDevicePixelRatioF = qimage.setDevicePixelRatio
+                except AttributeError:
+                    def qimage_setDevicePixelRatioF(scaleFactor): pass
+            qimage_setDevicePixelRatioF(ratio)
+            # FIXME[PySide{,2}]: https://bugreports.qt.io/browse/PYSIDE-140
+            if qt_compat.QT_API.startswith("PySide"):
+                ctypes.c_long.from_address(id(buf)).value -= 1
+            painter.drawImage(QtCore.QPointF(x / ratio, y / ratio), qimage)
         self._draw_rect_callback(painter)
         painter.end()
 
     def blit(self, bbox=None):
-        # See above: we always repaint the full canvas.
-        self.repaint(self.rect())
+        # Only repaint the blitted region, or the regions drawn over since the
+        # last blit if no bbox is given, in a single repaint.
+        ratio = self._dpi_ratio
+        rects = ([self._get_buffer_rect(bbox)] if bbox is not None
+                 else self.get_renderer()._get_damage(reset=True))
+        region = QtGui.QRegion()
+        for x, y, w, h in rects:
+            l = math.floor(x / ratio)
+            t = math.floor(y / ratio)
+            region = region.united(QtCore.QRect(
+                l, t, math.ceil((x + w) / ratio) - l,
+                math.ceil((y + h) / ratio) - t))
+        if not region.isEmpty():
+            self.repaint(region)
 
 
 @_BackendQT5.export
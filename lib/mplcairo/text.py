@@ -0,0 +1,92 @@
+import numpy as np
+
+from matplotlib import artist, colors as mcolors, rcParams
+from matplotlib.font_manager import FontProperties
+from matplotlib.text import Text
+from matplotlib.transforms import IdentityTransform
+
+
+class TextCollection(artist.Artist):
+    """
+    Many single-line, non-math texts sharing font properties.
+
+    With mplcairo, all texts are drawn with a single call to the renderer's
+    ``draw_texts``, which sets up the font once and draws unrotated texts of
+    the same color in a single batch (on raster outputs); other renderers draw
+    them one `.Text` at a time.
+
+    Usage is e.g.::
+
+        ax.add_artist(TextCollection(np.column_stack([xs, ys]), labels))
+
+    Parameters
+    ----------
+    offsets : (n, 2) array
+        Positions of the texts, in the artist's transform coordinates (data
+        coordinates, if added with `~.Axes.add_artist`).
+    texts : list of str
+    rotations : float or (n,) array, default: 0
+        Rotation angles, in degrees.  Texts are aligned as with
+        ``rotation_mode="anchor"``, i.e. the unrotated text is aligned with
+        its anchor and then rotated around it.
+    colors : color or list of colors, default: :rc:`text.color`
+    fontproperties : `.FontProperties`, optional
+    horizontalalignment : {"left", "center", "right"}, default: "center"
+    verticalalignment : {"baseline", "bottom", "center", "top"}, \
+default: "center"
+    **kwargs
+        Forwarded to `.Artist`.
+    """
+
+    def __init__(self, offsets, texts, *, rotations=0, colors=None,
+                 fontproperties=None, horizontalalignment="center",
+                 verticalalignment="center", **kwargs):
+        super().__init__()
+        self._offsets = np.asarray(offsets, float).reshape((-1, 2))
+        self._texts = [str(text) for text in texts]
+        if len(self._offsets) != len(self._texts):
+            raise ValueError("offsets and texts must have the same length")
+        self._rotations = rotations
+        self._colors = rcParams["text.color"] if colors is None else colors
+        self._fontproperties = (
+            fontproperties if isinstance(fontproperties, FontProperties)
+            else FontProperties(fontproperties))
+        self._ha = horizontalalignment
+        self._va = verticalalignment
+        self.update(kwargs)
+
+    @artist.allow_rasterization
+    def draw(self, renderer):
+        n = len(self._texts)
+        if not self.get_visible() or not n:
+            return
+        offsets = self.get_transform().transform(self._offsets)
+        rotations = np.broadcast_to(
+            np.asarray(self._rotations, float), n).copy()
+        colors = np.broadcast_to(
+            mcolors.to_rgba_array(self._colors, self.get_alpha()),
+            (n, 4)).copy()
+        renderer.open_group("textcollection", self.get_gid())
+        if hasattr(renderer, "draw_texts"):
+            gc = renderer.new_gc()
+            self._set_gc_clip(gc)
+            gc.set_url(self.get_url())
+            renderer.draw_texts(
+                gc, offsets, self._texts, self._fontproperties,
+                rotations, colors, self._ha, self._va)
+            gc.restore()
+        else:
+            for (x, y), s, rotation, color in zip(
+                    offsets, self._texts, rotations, colors):
+                text = Text(
+                    x, y, s, color=color, rotation=rotation,
+                    fontproperties=self._fontproperties,
+                    horizontalalignment=self._ha,
+                    verticalalignment=self._va,
+                    rotation_mode="anchor")
+                artist.Artist.update_from(text, self)
+                text.set_figure(self.figure)
+                text.set_transform(IdentityTransform())
+                text.draw(renderer)
+        renderer.close_group("textcollection")
+        self.stale = False
@@ -1,5 +1,6 @@
 from functools import partial
 
+import numpy as np
 from matplotlib.backends._backend_tk import _BackendTk, FigureCanvasTk
 
 from . import _util
@@ -14,17 +15,27 @@ except ImportError:
 
 
 class FigureCanvasTkCairo(FigureCanvasCairo, FigureCanvasTk):
+    _tk_buf = None
+
     def draw(self):
         super().draw()
-        buf = _util.cairo_to_premultiplied_rgba8888(
+        self._tk_buf = _util.cairo_to_premultiplied_rgba8888(
             self.get_renderer()._get_buffer())
-        _tk_blit(self._tkphoto, buf)
+        _tk_blit(self._tkphoto, self._tk_buf)
         self._master.update_idletasks()
 
     def blit(self, bbox=None):
-        buf = _util.cairo_to_premultiplied_rgba8888(
-            self.get_renderer()._get_buffer())
-        _tk_blit(self._tkphoto, buf, bbox=bbox)
+        buf = self.get_renderer()._get_buffer()
+        if (bbox is None or self._tk_buf is None
+                or self._tk_buf.shape != buf.shape):
+            self._tk_buf = _util.cairo_to_premultiplied_rgba8888(buf)
+        else:
+            # Only convert the blitted region, into the last converted buffer.
+            x, y, w, h = self._get_buffer_rect(bbox)
+            region = np.s_[y:y+h, x:x+w]
+            _util.cairo_to_premultiplied_rgba8888(
+                buf[region], out=self._tk_buf[region])
+        _tk_blit(self._tkphoto, self._tk_buf, bbox=bbox)
         self._master.update_idletasks()
 
 
@@ -30,7 +30,27 @@ class FigureCanvasWxCairo(FigureCanvasCairo, _FigureCanvasWxBase):
         self.gui_repaint(drawDC=drawDC, origin="WXCairo")
 
     def blit(self, bbox=None):
-        self.draw()
+        if not self._isDrawn:
+            self.draw()
+            return
+        # Update the bitmap only for the blitted region, or the regions drawn
+        # over since the last blit if no bbox is given, without redrawing the
+        # figure.
+        rects = [self._get_buffer_rect(bbox)] if bbox is not None else None
+        # Copy the pixels (rather than alpha-blending them with DrawBitmap),
+        # so that transparent regions do not keep the previous contents.
+        dc = wx.MemoryDC(self.bitmap)
+        src_dc = wx.MemoryDC()
+        for x, y, buf in self.get_renderer()._get_damaged_buffers(
+                "premultiplied_argb32", rects):
+            height, width, _ = buf.shape
+            bitmap = wx.Bitmap(width, height, 32)
+            bitmap.CopyFromBuffer(buf, wx.BitmapBufferFormat_ARGB32)
+            src_dc.SelectObject(bitmap)
+            dc.Blit(x, y, width, height, src_dc, 0, 0, wx.COPY, False)
+            src_dc.SelectObject(wx.NullBitmap)
+        dc.SelectObject(wx.NullBitmap)
+        self.gui_repaint(origin="WXCairo")
 
 
 @_BackendWx.export
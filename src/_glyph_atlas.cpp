@@ -0,0 +1,190 @@
+#include "_glyph_atlas.h"
+
+namespace mplcairo {
+
+namespace {
+
+constexpr auto N_PHASES = 4;  // Quarter-pixel positioning, in each direction.
+constexpr auto MAX_BYTES = size_t{1} << 26;  // NOTE: Arbitrary limit.
+
+struct FontKey {
+  // References keep the font face alive, and thus guarantee that the pointer
+  // will not get reused by another face.
+  std::shared_ptr<cairo_font_face_t> font_face;
+  cairo_matrix_t font_matrix;
+  std::shared_ptr<cairo_font_options_t> options;
+};
+
+struct FontKeyHash {
+  size_t operator()(FontKey const& key) const
+  {
+    // Reuse boost::hash_combine, as in PatternCache::Hash.
+    size_t hashes[] = {
+      std::hash<void*>{}(key.font_face.get()),
+      std::hash<double>{}(key.font_matrix.xx),
+      std::hash<double>{}(key.font_matrix.xy),
+      std::hash<double>{}(key.font_matrix.yx),
+      std::hash<double>{}(key.font_matrix.yy),
+      cairo_font_options_hash(key.options.get())};
+    auto seed = size_t{0};
+    for (size_t i = 0; i < sizeof(hashes) / sizeof(hashes[0]); ++i) {
+      seed ^= hashes[i] + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+    return seed;
+  }
+};
+
+struct FontKeyEqualTo {
+  bool operator()(FontKey const& lhs, FontKey const& rhs) const
+  {
+    return
+      lhs.font_face == rhs.font_face
+      && lhs.font_matrix.xx == rhs.font_matrix.xx
+      && lhs.font_matrix.xy == rhs.font_matrix.xy
+      && lhs.font_matrix.yx == rhs.font_matrix.yx
+      && lhs.font_matrix.yy == rhs.font_matrix.yy
+      && cairo_font_options_equal(lhs.options.get(), rhs.options.get());
+  }
+};
+
+// A rasterized glyph, to be masked with its origin at the integer device
+// position (x, y) relative to the (floored) glyph position.  The surface is
+// null for glyphs without ink (e.g. spaces).
+struct GlyphStamp {
+  cairo_surface_t* surface;
+  double x, y;
+};
+
+class GlyphAtlas {
+  // Glyph stamps by font, then by glyph index and phase.
+  std::unordered_map<
+    FontKey, std::unordered_map<unsigned long, GlyphStamp>,
+    FontKeyHash, FontKeyEqualTo> fonts_;
+  size_t bytes_{0};
+
+  public:
+  ~GlyphAtlas();
+
+  void show_glyphs(cairo_t* cr, cairo_glyph_t const* glyphs, int num_glyphs);
+  void clear();
+};
+
+GlyphAtlas::~GlyphAtlas()
+{
+  clear();
+}
+
+void GlyphAtlas::clear()
+{
+  for (auto const& [key, stamps]: fonts_) {
+    (void)key;
+    for (auto const& [idx, stamp]: stamps) {
+      (void)idx;
+      cairo_surface_destroy(stamp.surface);
+    }
+  }
+  fonts_.clear();
+  bytes_ = 0;
+}
+
+void GlyphAtlas::show_glyphs(
+  cairo_t* cr, cairo_glyph_t const* glyphs, int num_glyphs)
+{
+  if (bytes_ > MAX_BYTES) {
+    clear();  // Naive cache mechanism.
+  }
+  auto const& scaled_font = cairo_get_scaled_font(cr);
+  auto key = FontKey{
+    {cairo_font_face_reference(cairo_scaled_font_get_font_face(scaled_font)),
+     cairo_font_face_destroy},
+    {},
+    {cairo_font_options_create(), cairo_font_options_destroy}};
+  cairo_scaled_font_get_font_matrix(scaled_font, &key.font_matrix);
+  cairo_scaled_font_get_font_options(scaled_font, key.options.get());
+  auto& stamps = fonts_[key];
+  // A8 stamps cannot hold component alpha.
+  auto const& options = std::unique_ptr<
+    cairo_font_options_t, decltype(&cairo_font_options_destroy)>{
+      cairo_font_options_copy(key.options.get()), cairo_font_options_destroy};
+  if (cairo_font_options_get_antialias(options.get())
+      == CAIRO_ANTIALIAS_SUBPIXEL) {
+    cairo_font_options_set_antialias(options.get(), CAIRO_ANTIALIAS_GRAY);
+  }
+  cairo_save(cr);
+  for (auto i = 0; i < num_glyphs; ++i) {
+    auto const& glyph = glyphs[i];
+    auto x = glyph.x, y = glyph.y;
+    cairo_user_to_device(cr, &x, &y);
+    if (!std::isfinite(x) || !std::isfinite(y)) {
+      continue;
+    }
+    auto const& i_x = std::floor(x), & i_y = std::floor(y);
+    auto const& p_x = std::min(int((x - i_x) * N_PHASES), N_PHASES - 1),
+              & p_y = std::min(int((y - i_y) * N_PHASES), N_PHASES - 1);
+    auto const& idx = (glyph.index * N_PHASES + p_x) * N_PHASES + p_y;
+    auto it = stamps.find(idx);
+    if (it != stamps.end()) {
+      record_stat("glyph_atlas.hit");
+    } else {
+      auto const& timed = Timed{"glyph_atlas.miss"};
+      auto const& origin = cairo_glyph_t{glyph.index, 0, 0};
+      auto extents = cairo_text_extents_t{};
+      cairo_scaled_font_glyph_extents(scaled_font, &origin, 1, &extents);
+      auto stamp = GlyphStamp{nullptr, 0, 0};
+      if (extents.width > 0 && extents.height > 0) {
+        // Leave a margin for antialiasing and for the phase offset.
+        auto const& x0 = std::floor(extents.x_bearing) - 1,
+                  & y0 = std::floor(extents.y_bearing) - 1,
+                  & width =
+                    std::ceil(extents.x_bearing + extents.width) + 2 - x0,
+                  & height =
+                    std::ceil(extents.y_bearing + extents.height) + 2 - y0;
+        stamp = {
+          cairo_image_surface_create(CAIRO_FORMAT_A8, int(width), int(height)),
+          x0, y0};
+        auto const& stamp_cr = cairo_create(stamp.surface);
+        cairo_set_font_face(stamp_cr, key.font_face.get());
+        cairo_set_font_matrix(stamp_cr, &key.font_matrix);
+        cairo_set_font_options(stamp_cr, options.get());
+        auto const& shifted = cairo_glyph_t{
+          glyph.index,
+          -x0 + double(p_x) / N_PHASES, -y0 + double(p_y) / N_PHASES};
+        cairo_show_glyphs(stamp_cr, &shifted, 1);
+        cairo_destroy(stamp_cr);
+        auto const& bytes =
+          size_t(cairo_image_surface_get_stride(stamp.surface)) * height;
+        timed.add_items(bytes);
+        bytes_ += bytes;
+      }
+      it = stamps.emplace(idx, stamp).first;
+    }
+    if (auto const& stamp = it->second; stamp.surface) {
+      cairo_identity_matrix(cr);
+      cairo_mask_surface(cr, stamp.surface, i_x + stamp.x, i_y + stamp.y);
+      cairo_restore(cr);
+      cairo_save(cr);
+    }
+  }
+  cairo_restore(cr);
+}
+
+}
+
+void show_glyphs(cairo_t* cr, cairo_glyph_t const* glyphs, int num_glyphs)
+{
+  auto matrix = cairo_matrix_t{};
+  cairo_get_matrix(cr, &matrix);
+  if (!detail::GLYPH_ATLAS
+      || cairo_surface_get_type(cairo_get_group_target(cr))
+         != CAIRO_SURFACE_TYPE_IMAGE
+      || matrix.xx != 1 || matrix.yx != 0 || matrix.xy != 0 || matrix.yy != 1) {
+    cairo_show_glyphs(cr, glyphs, num_glyphs);
+    return;
+  }
+  // Intentionally leaked, so that no cairo/FreeType cleanup runs at
+  // interpreter shutdown.
+  static auto& atlas = *new GlyphAtlas{};
+  atlas.show_glyphs(cr, glyphs, num_glyphs);
+}
+
+}
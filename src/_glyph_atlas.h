@@ -0,0 +1,17 @@
+#pragma once
+
+#include "_util.h"
+
+namespace mplcairo {
+
+namespace py = pybind11;
+
+// Draw `glyphs` with the current scaled font and source of `cr`.  If the
+// glyph_atlas option is set, the target is an image surface and the CTM is a
+// pure translation, each glyph is rasterized once (per font and quarter-pixel
+// position) into an A8 stamp kept in a process-wide atlas, and then masked
+// onto the target, similarly to the stamps of PatternCache; otherwise, this
+// is just cairo_show_glyphs.
+void show_glyphs(cairo_t* cr, cairo_glyph_t const* glyphs, int num_glyphs);
+
+}
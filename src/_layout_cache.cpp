@@ -0,0 +1,167 @@
+#include "_layout_cache.h"
+
+#include "_mplcairo.h"
+#include "_raqm.h"
+
+namespace mplcairo {
+
+cairo_text_extents_t const& TextLayout::get_extents(cairo_t* cr)
+{
+  if (!extents) {
+    extents.emplace();
+    cairo_glyph_extents(cr, gac.glyphs, gac.num_glyphs, &*extents);
+  }
+  return *extents;
+}
+
+size_t LayoutCache::Hash::operator()(Key const& key) const
+{
+  // Reuse boost::hash_combine, as in PatternCache::Hash.
+  size_t hashes[] = {
+    std::hash<void*>{}(key.font_face.get()),
+    std::hash<double>{}(key.font_matrix.xx),
+    std::hash<double>{}(key.font_matrix.xy),
+    std::hash<double>{}(key.font_matrix.yx),
+    std::hash<double>{}(key.font_matrix.yy),
+    std::hash<double>{}(key.ctm.xx), std::hash<double>{}(key.ctm.xy),
+    std::hash<double>{}(key.ctm.yx), std::hash<double>{}(key.ctm.yy),
+    cairo_font_options_hash(key.options.get()),
+    std::hash<bool>{}(key.raqm),
+    std::hash<std::string>{}(key.text)};
+  auto seed = size_t{0};
+  for (size_t i = 0; i < sizeof(hashes) / sizeof(hashes[0]); ++i) {
+    seed ^= hashes[i] + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  }
+  return seed;
+}
+
+bool LayoutCache::EqualTo::operator()(Key const& lhs, Key const& rhs) const
+{
+  return
+    lhs.font_face == rhs.font_face
+    && lhs.font_matrix.xx == rhs.font_matrix.xx
+    && lhs.font_matrix.xy == rhs.font_matrix.xy
+    && lhs.font_matrix.yx == rhs.font_matrix.yx
+    && lhs.font_matrix.yy == rhs.font_matrix.yy
+    && lhs.ctm.xx == rhs.ctm.xx && lhs.ctm.xy == rhs.ctm.xy
+    && lhs.ctm.yx == rhs.ctm.yx && lhs.ctm.yy == rhs.ctm.yy
+    && cairo_font_options_equal(lhs.options.get(), rhs.options.get())
+    && lhs.raqm == rhs.raqm && lhs.text == rhs.text;
+}
+
+std::shared_ptr<TextLayout> LayoutCache::get(
+  cairo_t* cr, std::string const& s)
+{
+  auto const& scaled_font = cairo_get_scaled_font(cr);
+  auto key = Key{
+    {cairo_font_face_reference(cairo_scaled_font_get_font_face(scaled_font)),
+     cairo_font_face_destroy},
+    {}, {},
+    {cairo_font_options_create(), cairo_font_options_destroy},
+    has_raqm(), s};
+  cairo_scaled_font_get_font_matrix(scaled_font, &key.font_matrix);
+  cairo_scaled_font_get_ctm(scaled_font, &key.ctm);
+  cairo_scaled_font_get_font_options(scaled_font, key.options.get());
+  if (auto const& it = layouts_.find(key); it != layouts_.end()) {
+    record_stat("layout_cache.hit");
+    lru_.splice(lru_.begin(), lru_, it->second.lru_it);
+    return it->second.layout;
+  }
+  record_stat("layout_cache.miss");
+  auto const& layout = std::shared_ptr<TextLayout>{
+    new TextLayout{text_to_glyphs_and_clusters(cr, s), {}}};
+  auto const& [it, ok] = layouts_.emplace(std::move(key), Entry{layout, {}});
+  if (!ok) {
+    throw std::runtime_error{"unexpected insertion failure into cache"};
+  }
+  it->second.lru_it = lru_.insert(lru_.begin(), &it->first);
+  trim(detail::LAYOUT_CACHE_SIZE);
+  return layout;
+}
+
+// Evict the least recently used layouts until at most `max_size` remain.
+// Layouts that are still in use are kept alive by their shared_ptrs.
+void LayoutCache::trim(size_t max_size)
+{
+  while (layouts_.size() > max_size) {
+    auto const& it = layouts_.find(*lru_.back());
+    lru_.pop_back();
+    layouts_.erase(it);
+  }
+}
+
+size_t MathtextCache::Hash::operator()(Key const& key) const
+{
+  // Reuse boost::hash_combine, as in PatternCache::Hash.
+  size_t hashes[] = {
+    std::hash<std::string>{}(key.text),
+    std::hash<double>{}(key.dpi),
+    size_t(py::hash(key.prop_key)),
+    std::hash<long>{}(key.hinting_flag)};
+  auto seed = size_t{0};
+  for (size_t i = 0; i < sizeof(hashes) / sizeof(hashes[0]); ++i) {
+    seed ^= hashes[i] + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  }
+  return seed;
+}
+
+bool MathtextCache::EqualTo::operator()(Key const& lhs, Key const& rhs) const
+{
+  return
+    lhs.text == rhs.text && lhs.dpi == rhs.dpi
+    && lhs.prop_key.equal(rhs.prop_key)
+    && lhs.hinting_flag == rhs.hinting_flag;
+}
+
+std::shared_ptr<MathtextBackend const> MathtextCache::get(
+  std::string const& s, double dpi, py::object prop)
+{
+  auto key = Key{s, dpi, font_prop_key(prop), get_hinting_flag()};
+  if (auto const& it = backends_.find(key); it != backends_.end()) {
+    record_stat("mathtext_cache.hit");
+    lru_.splice(lru_.begin(), lru_, it->second.lru_it);
+    return it->second.backend;
+  }
+  auto const& timed = Timed{"mathtext_cache.miss", s.size()};
+  // Copying is cheap: glyphs only hold references to their font faces.
+  auto const& backend = std::make_shared<MathtextBackend const>(
+    py::module::import("mplcairo")
+    .attr("_mathtext_parse")(s, dpi, prop).cast<MathtextBackend&>());
+  auto const& [it, ok] =
+    backends_.emplace(std::move(key), Entry{backend, {}});
+  if (!ok) {
+    throw std::runtime_error{"unexpected insertion failure into cache"};
+  }
+  it->second.lru_it = lru_.insert(lru_.begin(), &it->first);
+  trim(detail::LAYOUT_CACHE_SIZE);
+  return backend;
+}
+
+// Evict the least recently used entries until at most `max_size` remain.
+void MathtextCache::trim(size_t max_size)
+{
+  while (backends_.size() > max_size) {
+    auto const& it = backends_.find(*lru_.back());
+    lru_.pop_back();
+    backends_.erase(it);
+  }
+}
+
+std::shared_ptr<TextLayout> shape_text(cairo_t* cr, std::string const& s)
+{
+  // Intentionally leaked, so that no cairo/FreeType cleanup runs at
+  // interpreter shutdown.
+  static auto& cache = *new LayoutCache{};
+  return cache.get(cr, s);
+}
+
+std::shared_ptr<MathtextBackend const> parse_mathtext(
+  std::string const& s, double dpi, py::object prop)
+{
+  // Intentionally leaked, so that no cairo/FreeType cleanup runs at
+  // interpreter shutdown.
+  static auto& cache = *new MathtextCache{};
+  return cache.get(s, dpi, prop);
+}
+
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "_util.h"
+
+#include <list>
+
+namespace mplcairo {
+
+namespace py = pybind11;
+
+// Shaped text, and its (lazily computed) extents.
+struct TextLayout {
+  GlyphsAndClusters gac;
+  std::optional<cairo_text_extents_t> extents;
+
+  cairo_text_extents_t const& get_extents(cairo_t* cr);
+};
+
+// Process-wide cache of shaped texts, evicting the least recently used ones
+// first.  The key covers everything that affects shaping, as recorded in the
+// current scaled font (font face, font matrix, CTM, and font options merged
+// with the surface's), plus whether raqm is used and the string itself.
+// Texts are always shaped with the GIL held, which also protects the cache.
+class LayoutCache {
+  struct Key {
+    // References keep the font face alive, and thus guarantee that the
+    // pointer will not get reused by another face.
+    std::shared_ptr<cairo_font_face_t> font_face;
+    cairo_matrix_t font_matrix, ctm;
+    std::shared_ptr<cairo_font_options_t> options;
+    bool raqm;
+    std::string text;
+  };
+  struct Hash {
+    size_t operator()(Key const& key) const;
+  };
+  struct EqualTo {
+    bool operator()(Key const& lhs, Key const& rhs) const;
+  };
+  struct Entry {
+    std::shared_ptr<TextLayout> layout;
+    std::list<Key const*>::iterator lru_it;
+  };
+
+  std::unordered_map<Key, Entry, Hash, EqualTo> layouts_;
+  // Keys of layouts_ (whose addresses are stable), most recently used first.
+  std::list<Key const*> lru_;
+
+  public:
+  std::shared_ptr<TextLayout> get(cairo_t* cr, std::string const& s);
+  void trim(size_t max_size);
+};
+
+class MathtextBackend;
+
+// Process-wide cache of parsed mathtext, evicting the least recently used
+// entries first.  The key is the string, the dpi, the font properties (as
+// font_prop_key, compared by value, whereas Matplotlib's own lru_cache'd
+// parser compares them with FontProperties.__eq__, which only compares
+// hashes) and the hinting flag (with which the referenced font faces were
+// created).  Mathtext is always parsed with the GIL held, which also protects
+// the cache (and the Python objects in its keys).
+class MathtextCache {
+  struct Key {
+    std::string text;
+    double dpi;
+    py::object prop_key;
+    long hinting_flag;
+  };
+  struct Hash {
+    size_t operator()(Key const& key) const;
+  };
+  struct EqualTo {
+    bool operator()(Key const& lhs, Key const& rhs) const;
+  };
+  struct Entry {
+    std::shared_ptr<MathtextBackend const> backend;
+    std::list<Key const*>::iterator lru_it;
+  };
+
+  std::unordered_map<Key, Entry, Hash, EqualTo> backends_;
+  // Keys of backends_ (whose addresses are stable), most recently used first.
+  std::list<Key const*> lru_;
+
+  public:
+  std::shared_ptr<MathtextBackend const> get(
+    std::string const& s, double dpi, py::object prop);
+  void trim(size_t max_size);
+};
+
+// Shape `s` with the current font settings of `cr`, going through the
+// process-wide LayoutCache.
+std::shared_ptr<TextLayout> shape_text(cairo_t* cr, std::string const& s);
+
+// Parse `s` as mathtext, going through the process-wide MathtextCache.
+std::shared_ptr<MathtextBackend const> parse_mathtext(
+  std::string const& s, double dpi, py::object prop);
+
+}
@@ -1,7 +1,10 @@
 #include "_mplcairo.h"
 
+#include "_glyph_atlas.h"
+#include "_layout_cache.h"
 #include "_os.h"
 #include "_pattern_cache.h"
+#include "_png.h"
 #include "_raqm.h"
 #include "_util.h"
 
@@ -10,6 +13,10 @@
 #endif
 #include <cairo-script.h>
 
+#include <algorithm>
+#include <cstring>
+#include <list>
+#include <mutex>
 #include <stack>
 #include <thread>
 
@@ -100,7 +107,8 @@ P11X_DECLARE_ENUM(
   {"PS", mplcairo::StreamSurfaceType::PS},
   {"EPS", mplcairo::StreamSurfaceType::EPS},
   {"SVG", mplcairo::StreamSurfaceType::SVG},
-  {"Script", mplcairo::StreamSurfaceType::Script}
+  {"Script", mplcairo::StreamSurfaceType::Script},
+  {"Recording", mplcairo::StreamSurfaceType::Recording}
 )
 
 namespace mplcairo {
@@ -115,22 +123,8 @@ Region::Region(
 py::array_t<uint8_t> Region::get_st_rgba8888_array() {
   auto const& [x0, y0, width, height] = bbox;
   auto st_rgba8888_array = py::array_t<uint8_t>{{height, width, 4}};
-  auto st_rgba8888_ptr =
-    st_rgba8888_array.mutable_unchecked<3>().mutable_data(0, 0, 0);
-  for (auto y = 0; y < height; ++y) {
-    for (auto x = 0; x < width; ++x) {
-      auto argb32 =
-        *(reinterpret_cast<uint32_t const*>(buffer.get()) + y * width + x);
-      auto const& a = (argb32 & 0xff000000) >> 24,
-                & r = (argb32 & 0x00ff0000) >> 16,
-                & g = (argb32 & 0x0000ff00) >> 8,
-                & b = (argb32 & 0x000000ff) >> 0;
-      *(st_rgba8888_ptr++) = (r * 0xff + a / 2) / a;
-      *(st_rgba8888_ptr++) = (g * 0xff + a / 2) / a;
-      *(st_rgba8888_ptr++) = (b * 0xff + a / 2) / a;
-      *(st_rgba8888_ptr++) = a;
-    }
-  }
+  argb32_to_straight_rgba8888(
+    buffer.get(), st_rgba8888_array.mutable_data(), height * width);
   return st_rgba8888_array;
 }
 
@@ -142,20 +136,14 @@ py::bytes Region::get_st_argb32_bytes() {
   PY_CHECK(
     PyBytes_AsStringAndSize,
     st_argb32_bytes.ptr(), reinterpret_cast<char**>(&st_argb32_ptr), &len);
-  for (auto y = 0; y < height; ++y) {
-    for (auto x = 0; x < width; ++x) {
-      auto argb32 =
-        *(reinterpret_cast<uint32_t const*>(buffer.get()) + y * width + x);
-      auto const& a = (argb32 & 0xff000000) >> 24,
-                & r = (argb32 & 0x00ff0000) >> 16,
-                & g = (argb32 & 0x0000ff00) >> 8,
-                & b = (argb32 & 0x000000ff) >> 0;
-      *(st_argb32_ptr++) =
-        (uint8_t(a) << 24)
-        | (uint8_t((r * 0xff + a / 2) / a) << 16)
-        | (uint8_t((g * 0xff + a / 2) / a) << 8)
-        | (uint8_t((b * 0xff + a / 2) / a) << 0);
-    }
+  // Straighten to RGBA8888, then repack in place as (straight) ARGB32.
+  auto const& st_ptr = reinterpret_cast<uint8_t*>(st_argb32_ptr);
+  argb32_to_straight_rgba8888(buffer.get(), st_ptr, height * width);
+  for (auto i = 0; i < height * width; ++i) {
+    auto const& px = st_ptr + 4 * i;
+    st_argb32_ptr[i] =
+      (uint32_t(px[3]) << 24) | (uint32_t(px[0]) << 16)
+      | (uint32_t(px[1]) << 8) | (uint32_t(px[2]) << 0);
   }
   return st_argb32_bytes;
 }
@@ -216,10 +204,17 @@ GraphicsContextRenderer::AdditionalContext::AdditionalContext(
           "cairo_tag_begin requires cairo>=1.15.4");
     }
   }
+  gcr_->damage_recorded_ = false;
 }
 
 GraphicsContextRenderer::AdditionalContext::~AdditionalContext()
 {
+  // Unless the draw call recorded tighter bounds, assume that it drew over its
+  // whole clip (which is still set).
+  if (!gcr_->damage_recorded_) {
+    auto const& inf = std::numeric_limits<double>::infinity();
+    gcr_->add_damage(-inf, -inf, inf, inf);
+  }
   if (gcr_->get_additional_state().url && detail::cairo_tag_end) {
     detail::cairo_tag_end(gcr_->cr_, CAIRO_TAG_LINK);
   }
@@ -241,6 +236,59 @@ rgba_t GraphicsContextRenderer::get_rgba()
   return {r, g, b, a};
 }
 
+// Record that the user-space rectangle from (x0, y0) to (x1, y1), within the
+// current clip, was drawn over.  The rectangle may be infinite, to record the
+// whole clip.
+void GraphicsContextRenderer::add_damage(
+  double x0, double y0, double x1, double y1)
+{
+  damage_recorded_ = true;
+  auto const& to_device = [&](
+    double& x0, double& y0, double& x1, double& y1) -> void {
+    auto const& inf = std::numeric_limits<double>::infinity();
+    auto dx0 = inf, dy0 = inf, dx1 = -inf, dy1 = -inf;
+    for (auto [x, y]: {std::tuple{x0, y0}, std::tuple{x1, y0},
+                       std::tuple{x0, y1}, std::tuple{x1, y1}}) {
+      cairo_user_to_device(cr_, &x, &y);
+      dx0 = std::min(dx0, x); dx1 = std::max(dx1, x);
+      dy0 = std::min(dy0, y); dy1 = std::max(dy1, y);
+    }
+    x0 = dx0; y0 = dy0; x1 = dx1; y1 = dy1;
+  };
+  double cx0, cy0, cx1, cy1;
+  cairo_clip_extents(cr_, &cx0, &cy0, &cx1, &cy1);
+  to_device(cx0, cy0, cx1, cy1);
+  if (std::isfinite(x0) && std::isfinite(y0)
+      && std::isfinite(x1) && std::isfinite(y1)) {
+    to_device(x0, y0, x1, y1);
+    cx0 = std::max(cx0, x0); cx1 = std::min(cx1, x1);
+    cy0 = std::max(cy0, y0); cy1 = std::min(cy1, y1);
+  }
+  auto const& i_x0 = std::floor(cx0), & i_x1 = std::ceil(cx1),
+            & i_y0 = std::floor(cy0), & i_y1 = std::ceil(cy1);
+  if (i_x0 < i_x1 && i_y0 < i_y1) {
+    add_damage({
+      int(i_x0), int(i_y0), int(i_x1 - i_x0), int(i_y1 - i_y0)});
+  }
+}
+
+// Record that the device-space rectangle `rect` was drawn over.  This is a
+// no-op except when drawing directly (not in a group) onto an image surface.
+void GraphicsContextRenderer::add_damage(cairo_rectangle_int_t const& rect)
+{
+  auto const& surface = cairo_get_target(cr_);
+  if (cairo_surface_get_type(surface) != CAIRO_SURFACE_TYPE_IMAGE
+      || cairo_get_group_target(cr_) != surface) {
+    return;
+  }
+  for (auto region: {&damage_, &layer_damage_}) {
+    if (!*region) {
+      region->reset(cairo_region_create(), cairo_region_destroy);
+    }
+    cairo_region_union_rectangle(region->get(), &rect);
+  }
+}
+
 GraphicsContextRenderer::GraphicsContextRenderer(
   cairo_t* cr, double width, double height, double dpi) :
   // This does *not* incref the cairo_t, but the destructor *will* decref it.
@@ -256,15 +304,12 @@ GraphicsContextRenderer::GraphicsContextRenderer(
   // JOIN_ROUND (cairo defaults to JOIN_MITER) and CAP_BUTT (cairo too).  See
   // GraphicsContextBase.__init__.
   cairo_set_line_join(cr, CAIRO_LINE_JOIN_ROUND);
-  // May already have been set by cr_from_fileformat_args.
-  if (!cairo_get_user_data(cr, &detail::REFS_KEY)) {
-    CAIRO_CHECK(
-      cairo_set_user_data, cr, &detail::REFS_KEY,
-      new std::vector<py::object>{},
-      [](void* data) -> void {
-        delete static_cast<std::vector<py::object>*>(data);
-      });
-  }
+  CAIRO_CHECK(
+    cairo_set_user_data, cr, &detail::REFS_KEY,
+    new std::vector<py::object>{},
+    [](void* data) -> void {
+      delete static_cast<std::vector<py::object>*>(data);
+    });
   auto const& stack = new std::stack<AdditionalState>{{{
     /* width */           width,
     /* height */          height,
@@ -288,13 +333,117 @@ GraphicsContextRenderer::GraphicsContextRenderer(
     });
 }
 
+namespace {
+
+// Image surfaces allocated by cr_from_image_args are tagged with POOL_KEY.
+// When their renderer gets destroyed and nothing else still references them
+// (e.g. a buffer returned by _get_buffer), they are kept in a process-wide
+// pool (up to surface_pool_bytes, most recently released first) from which
+// later renderers of the same size and format are allocated, skipping the
+// allocation and page faulting of a fresh multi-megabyte buffer.
+cairo_user_data_key_t const POOL_KEY{};
+
+struct SurfacePool {
+  std::mutex mutex;
+  std::list<cairo_surface_t*> surfaces;
+  size_t bytes{0};
+};
+
+// Intentionally leaked, so that no cairo cleanup runs at interpreter shutdown.
+SurfacePool& surface_pool = *new SurfacePool{};
+
+size_t image_surface_bytes(cairo_surface_t* surface)
+{
+  return
+    size_t(cairo_image_surface_get_stride(surface))
+    * cairo_image_surface_get_height(surface);
+}
+
+cairo_surface_t* take_pooled_surface(
+  cairo_format_t format, int width, int height)
+{
+  auto surface = static_cast<cairo_surface_t*>(nullptr);
+  {
+    auto const& lock = std::unique_lock{surface_pool.mutex};
+    auto const& it = std::find_if(
+      surface_pool.surfaces.begin(), surface_pool.surfaces.end(),
+      [&](cairo_surface_t* surface) -> bool {
+        return cairo_image_surface_get_format(surface) == format
+          && cairo_image_surface_get_width(surface) == width
+          && cairo_image_surface_get_height(surface) == height;
+      });
+    if (it != surface_pool.surfaces.end()) {
+      surface = *it;
+      surface_pool.surfaces.erase(it);
+      surface_pool.bytes -= image_surface_bytes(surface);
+    }
+  }
+  if (surface) {
+    // The pages are already mapped, so clearing them is fast.
+    cairo_surface_flush(surface);
+    std::memset(
+      cairo_image_surface_get_data(surface), 0, image_surface_bytes(surface));
+    cairo_surface_mark_dirty(surface);
+  } else {
+    surface = cairo_image_surface_create(format, width, height);
+    cairo_surface_set_user_data(surface, &POOL_KEY, surface, nullptr);
+  }
+  return surface;
+}
+
+// Evict the least recently released surfaces until at most
+// surface_pool_bytes are pooled.
+void trim_surface_pool()
+{
+  auto evicted = std::vector<cairo_surface_t*>{};
+  {
+    auto const& lock = std::unique_lock{surface_pool.mutex};
+    while (surface_pool.bytes > detail::SURFACE_POOL_BYTES) {
+      auto const& last = surface_pool.surfaces.back();
+      surface_pool.bytes -= image_surface_bytes(last);
+      surface_pool.surfaces.pop_back();
+      evicted.push_back(last);
+    }
+  }
+  for (auto const& surface: evicted) {
+    cairo_surface_destroy(surface);
+  }
+}
+
+// Steal the reference to `surface`, either keeping it in the pool or
+// destroying it.
+void release_pooled_surface(cairo_surface_t* surface)
+{
+  if (cairo_surface_get_reference_count(surface) != 1
+      || cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS) {
+    cairo_surface_destroy(surface);
+    return;
+  }
+  {
+    auto const& lock = std::unique_lock{surface_pool.mutex};
+    surface_pool.surfaces.push_front(surface);
+    surface_pool.bytes += image_surface_bytes(surface);
+  }
+  trim_surface_pool();
+}
+
+}
+
 GraphicsContextRenderer::~GraphicsContextRenderer()
 {
   if (detail::FONT_CACHE.size() > 64) {  // font_manager._get_font cache size.
-    detail::FONT_CACHE.clear();  // Naive cache mechanism.
+    clear_font_cache();  // Naive cache mechanism.
   }
   try {
+    auto const& surface = cairo_get_target(cr_);
+    auto const& pooled = cairo_surface_get_user_data(surface, &POOL_KEY);
+    if (pooled) {
+      cairo_surface_reference(surface);
+    }
     cairo_destroy(cr_);
+    if (pooled) {
+      release_pooled_surface(surface);
+    }
   } catch (std::exception const& e) {
     // Exceptions would cause a fatal abort from the destructor if _finish is
     // not called on e.g. a SVG surface before the GCR gets GC'd. e.g. comment
@@ -312,7 +461,7 @@ GraphicsContextRenderer::~GraphicsContextRenderer()
 cairo_t* GraphicsContextRenderer::cr_from_image_args(int width, int height)
 {
   auto const& surface =
-    cairo_image_surface_create(get_cairo_format(), width, height);
+    take_pooled_surface(get_cairo_format(), width, height);
   auto const& cr = cairo_create(surface);
   cairo_surface_destroy(surface);
   return cr;
@@ -352,6 +501,15 @@ cairo_t* GraphicsContextRenderer::cr_from_fileformat_args(
   StreamSurfaceType type, py::object file,
   double width, double height, double dpi)
 {
+  if (type == StreamSurfaceType::Recording) {
+    // file is ignored.
+    auto const& extents = cairo_rectangle_t{0, 0, width, height};
+    auto const& surface =
+      cairo_recording_surface_create(CAIRO_CONTENT_COLOR_ALPHA, &extents);
+    auto const& cr = cairo_create(surface);
+    cairo_surface_destroy(surface);
+    return cr;
+  }
   auto surface_create_for_stream =
     [&]() -> cairo_surface_t* (*)(cairo_write_func_t, void*, double, double) {
       switch (type) {
@@ -383,34 +541,32 @@ cairo_t* GraphicsContextRenderer::cr_from_fileformat_args(
       "cairo was built without {.name} support"_format(type)
       .cast<std::string>()};
   }
-  auto const& cb =
-    [](void* closure, unsigned char const* data, unsigned int length)
-       -> cairo_status_t {
-      auto const& write =
-        py::reinterpret_borrow<py::object>(static_cast<PyObject*>(closure));
-      // FIXME[pybind11]: Work around lack of const buffers in pybind11.
-      auto const& buf_info = py::buffer_info{
-        const_cast<unsigned char*>(data),
-        sizeof(char), py::format_descriptor<char>::format(),
-        1, {length}, {sizeof(char)}};
-      return
-        write(py::memoryview{buf_info}).cast<unsigned int>() == length
-        // NOTE: This does not appear to affect the context status.
-        ? CAIRO_STATUS_SUCCESS : CAIRO_STATUS_WRITE_ERROR;
-    };
-  auto const& write = file.attr("write");
-
+  auto const& writer = new StreamWriter{file};
   auto const& surface =
-    surface_create_for_stream(cb, write.ptr(), width, height);
+    surface_create_for_stream(StreamWriter::write, writer, width, height);
+  auto const& destroy = [](void* data) -> void {
+    auto const& gil = py::gil_scoped_acquire{};
+    delete static_cast<StreamWriter*>(data);
+  };
+  // The script device (not the surface) does the writing, and may still do
+  // so when it is destroyed, after the surface.
+  auto const& device = cairo_surface_get_device(surface);
+  if (auto const& status =
+        type != StreamSurfaceType::Script
+        ? cairo_surface_set_user_data(
+            surface, &detail::WRITER_KEY, writer, destroy)
+        : device
+        ? cairo_device_set_user_data(
+            device, &detail::WRITER_KEY, writer, destroy)
+        : CAIRO_STATUS_NULL_POINTER;
+      status != CAIRO_STATUS_SUCCESS) {
+    // Error surface, which never writes; the error is reported by the
+    // constructor.
+    delete writer;
+  }
   cairo_surface_set_fallback_resolution(surface, dpi, dpi);
   auto const& cr = cairo_create(surface);
   cairo_surface_destroy(surface);
-  CAIRO_CHECK(
-    cairo_set_user_data, cr, &detail::REFS_KEY,
-    new std::vector<py::object>{{write}},
-    [](void* data) -> void {
-      delete static_cast<std::vector<py::object>*>(data);
-    });
   if (type == StreamSurfaceType::EPS) {
     // If cairo was built without PS support, we'd already have errored above.
     detail::cairo_ps_surface_set_eps(surface, true);
@@ -544,9 +700,20 @@ void GraphicsContextRenderer::_set_size(
     case CAIRO_SURFACE_TYPE_PS:
       detail::cairo_ps_surface_set_size(surface, width, height);
       break;
+    case CAIRO_SURFACE_TYPE_RECORDING: {
+      // The extents of a recording surface are fixed at creation.
+      auto extents = cairo_rectangle_t{};
+      if (!cairo_recording_surface_get_extents(surface, &extents)
+          || extents.width != width || extents.height != height) {
+        throw std::invalid_argument{
+          "_set_size cannot resize recording surfaces"};
+      }
+      break;
+    }
     default:
       throw std::invalid_argument{
-        "_set_size only supports PDF and PS surfaces, not {.name}"_format(type)
+        "_set_size only supports PDF, PS, and recording surfaces, not "
+        "{.name}"_format(type)
         .cast<std::string>()};
   }
 }
@@ -556,14 +723,213 @@ void GraphicsContextRenderer::_show_page()
   cairo_show_page(cr_);
 }
 
+void GraphicsContextRenderer::_replay_page(GraphicsContextRenderer& page)
+{
+  auto const& source = cairo_get_target(page.cr_);
+  if (auto const& type = cairo_surface_get_type(source);
+      type != CAIRO_SURFACE_TYPE_RECORDING) {
+    throw std::invalid_argument{
+      "_replay_page only supports recording surfaces, not {.name}"_format(type)
+      .cast<std::string>()};
+  }
+  cairo_surface_flush(source);
+  {
+    auto const& nogil = ReleaseGIL{};
+    cairo_save(cr_);
+    cairo_identity_matrix(cr_);
+    cairo_reset_clip(cr_);
+    cairo_set_source_surface(cr_, source, 0, 0);
+    cairo_paint(cr_);
+    cairo_restore(cr_);
+    cairo_show_page(cr_);
+  }
+  CAIRO_CHECK(cairo_status, cr_);
+}
+
 py::array GraphicsContextRenderer::_get_buffer()
 {
   return image_surface_to_buffer(cairo_get_target(cr_));
 }
 
+py::dict GraphicsContextRenderer::_get_stats(bool reset)
+{
+  auto stats = py::dict{};
+  for (auto const& [name, entry]: stats_.entries) {
+    stats[name.c_str()] = py::dict(
+      "calls"_a=entry.calls, "items"_a=entry.items,
+      "seconds"_a=entry.seconds);
+  }
+  if (reset) {
+    stats_.entries.clear();
+  }
+  return stats;
+}
+
+// Return the (x, y, width, height) device-space rectangles drawn over since
+// the last call with `reset` set (empty for non-image surfaces).  Each draw
+// call records the extents of its clip, or, for single texts, of their ink.
+std::vector<std::tuple<int, int, int, int>>
+GraphicsContextRenderer::_get_damage(bool reset)
+{
+  auto rects = std::vector<std::tuple<int, int, int, int>>{};
+  if (damage_) {
+    auto const& n = cairo_region_num_rectangles(damage_.get());
+    for (auto i = 0; i < n; ++i) {
+      auto rect = cairo_rectangle_int_t{};
+      cairo_region_get_rectangle(damage_.get(), i, &rect);
+      rects.emplace_back(rect.x, rect.y, rect.width, rect.height);
+    }
+  }
+  if (reset) {
+    damage_.reset();
+  }
+  return rects;
+}
+
+// Return the (x, y, buffer) parts of the canvas covering `rects` (by default,
+// the damage, which is then reset), converted to `format` (see PixelFormat).
+// Parts spanning the full canvas width which need no conversion are views
+// into the surface (kept alive as for _get_buffer); all other parts are
+// converted into compact buffers, so that GUI toolkits can be handed only the
+// pixels that changed.
+std::vector<std::tuple<int, int, py::array_t<uint8_t>>>
+GraphicsContextRenderer::_get_damaged_buffers(
+  std::string format,
+  std::optional<std::vector<std::tuple<int, int, int, int>>> rects)
+{
+  auto const& target =
+    format == "premultiplied_argb32" ? PixelFormat::PremultipliedARGB32
+    : format == "premultiplied_rgba8888" ? PixelFormat::PremultipliedRGBA8888
+    : format == "straight_rgba8888" ? PixelFormat::StraightRGBA8888
+    : throw std::invalid_argument{"invalid format: " + format};
+  auto const& buf = image_surface_to_buffer(cairo_get_target(cr_));
+  if (!rects) {
+    rects = _get_damage(true);
+  }
+  auto const& height = int(buf.shape(0)), width = int(buf.shape(1));
+  auto parts = std::vector<std::tuple<int, int, py::array_t<uint8_t>>>{};
+  for (auto const& [x, y, w, h]: *rects) {
+    auto const& x0 = std::max(x, 0), & x1 = std::min(x + w, width),
+              & y0 = std::max(y, 0), & y1 = std::min(y + h, height);
+    if (!(x0 < x1 && y0 < y1)) {
+      continue;
+    }
+    auto const& view =
+      buf[py::make_tuple(py::slice(y0, y1, 1), py::slice(x0, x1, 1))]
+      .cast<py::array>();
+    auto const& out =
+      x1 - x0 == width
+      ? std::optional<py::array_t<uint8_t>>{}
+      : py::array_t<uint8_t>{{ssize_t{y1 - y0}, ssize_t{x1 - x0}, ssize_t{4}}};
+    parts.emplace_back(x0, y0, convert_cairo_buffer(view, target, out));
+  }
+  return parts;
+}
+
+// Snapshot the canvas into a layer (e.g., the static background of an
+// animation), which can later be restored with _restore_layer.
+Layer GraphicsContextRenderer::_snapshot_layer()
+{
+  auto const& surface = cairo_get_target(cr_);
+  if (auto const& type = cairo_surface_get_type(surface);
+      type != CAIRO_SURFACE_TYPE_IMAGE) {
+    throw std::runtime_error{
+      "_snapshot_layer only supports IMAGE surfaces, not {.name}"_format(type)
+      .cast<std::string>()};
+  }
+  auto const& snapshot =
+    cairo_surface_create_similar_image(
+      surface, cairo_image_surface_get_format(surface),
+      cairo_image_surface_get_width(surface),
+      cairo_image_surface_get_height(surface));
+  auto const& snapshot_cr = cairo_create(snapshot);
+  cairo_set_operator(snapshot_cr, CAIRO_OPERATOR_SOURCE);
+  cairo_set_source_surface(snapshot_cr, surface, 0, 0);
+  {
+    auto const& nogil = ReleaseGIL{};
+    cairo_paint(snapshot_cr);
+  }
+  cairo_destroy(snapshot_cr);
+  auto const& layer = Layer{{snapshot, cairo_surface_destroy}};
+  layer_ = layer.surface;
+  layer_damage_.reset();
+  return layer;
+}
+
+// Restore a layer returned by _snapshot_layer.  If it is the last layer that
+// was snapshot or restored on this renderer, only the regions drawn over since
+// then are repainted.
+void GraphicsContextRenderer::_restore_layer(Layer const& layer)
+{
+  auto const& surface = cairo_get_target(cr_);
+  if (auto const& type = cairo_surface_get_type(surface);
+      type != CAIRO_SURFACE_TYPE_IMAGE) {
+    throw std::runtime_error{
+      "_restore_layer only supports IMAGE surfaces, not {.name}"_format(type)
+      .cast<std::string>()};
+  }
+  auto const& width = cairo_image_surface_get_width(surface),
+            & height = cairo_image_surface_get_height(surface);
+  if (cairo_image_surface_get_width(layer.surface.get()) != width
+      || cairo_image_surface_get_height(layer.surface.get()) != height) {
+    throw std::invalid_argument{"layer size does not match canvas size"};
+  }
+  cairo_save(cr_);
+  cairo_identity_matrix(cr_);
+  cairo_reset_clip(cr_);
+  auto repaint = true;
+  if (layer_.lock() == layer.surface) {
+    // Only repaint what was drawn over since the layer was snapshot or last
+    // restored.
+    repaint = bool(layer_damage_);
+    if (repaint) {
+      auto const& n = cairo_region_num_rectangles(layer_damage_.get());
+      for (auto i = 0; i < n; ++i) {
+        auto rect = cairo_rectangle_int_t{};
+        cairo_region_get_rectangle(layer_damage_.get(), i, &rect);
+        cairo_rectangle(cr_, rect.x, rect.y, rect.width, rect.height);
+        add_damage(rect);
+      }
+      cairo_clip(cr_);
+    }
+  } else {
+    add_damage({0, 0, width, height});
+  }
+  if (repaint) {
+    cairo_set_operator(cr_, CAIRO_OPERATOR_SOURCE);
+    cairo_set_source_surface(cr_, layer.surface.get(), 0, 0);
+    auto const& nogil = ReleaseGIL{};
+    cairo_paint(cr_);
+  }
+  cairo_restore(cr_);
+  layer_ = layer.surface;
+  layer_damage_.reset();
+}
+
+void GraphicsContextRenderer::_write_png(
+  py::object file, py::dict metadata, std::tuple<double, double> dpi,
+  int compress_level, std::string filter)
+{
+  write_png(
+    cairo_get_target(cr_), file, metadata, dpi, compress_level, filter);
+}
+
 void GraphicsContextRenderer::_finish()
 {
-  cairo_surface_finish(cairo_get_target(cr_));
+  auto const& surface = cairo_get_target(cr_);
+  cairo_surface_finish(surface);
+  auto writer = static_cast<StreamWriter*>(
+    cairo_surface_get_user_data(surface, &detail::WRITER_KEY));
+  if (auto const& device = cairo_surface_get_device(surface)) {
+    cairo_device_flush(device);
+    if (!writer) {
+      writer = static_cast<StreamWriter*>(
+        cairo_device_get_user_data(device, &detail::WRITER_KEY));
+    }
+  }
+  if (writer) {
+    writer->finish();
+  }
 }
 
 void GraphicsContextRenderer::set_alpha(std::optional<double> alpha)
@@ -609,9 +975,49 @@ void GraphicsContextRenderer::set_clip_path(
       .cast<std::tuple<py::object, py::object>>();
     auto const& matrix =
       matrix_from_transform(transform, get_additional_state().height);
-    load_path_exact(cr_, path, &matrix);
+    // Compare everything that load_path_exact depends on.
+    using array_t =
+      py::array_t<double, py::array::c_style | py::array::forcecast>;
+    using codes_t =
+      py::array_t<uint8_t, py::array::c_style | py::array::forcecast>;
+    auto const& vertices = path.attr("vertices").cast<array_t>();
+    auto const& codes = path.attr("codes").cast<std::optional<codes_t>>();
+    auto ctm = cairo_matrix_t{};
+    cairo_get_matrix(cr_, &ctm);
+    auto const& snap =
+      !has_vector_surface(cr_) && get_additional_state().snap;
+    auto const& line_width = cairo_get_line_width(cr_);
+    auto const& matrix_eq = [](
+      cairo_matrix_t const& lhs, cairo_matrix_t const& rhs) -> bool {
+      return lhs.xx == rhs.xx && lhs.yx == rhs.yx && lhs.xy == rhs.xy
+        && lhs.yy == rhs.yy && lhs.x0 == rhs.x0 && lhs.y0 == rhs.y0;
+    };
+    auto const& c = clip_path_cache_;
+    if (c
+        && c->vertices.size() == size_t(vertices.size())
+        && std::equal(
+             c->vertices.begin(), c->vertices.end(), vertices.data())
+        && c->codes.has_value() == codes.has_value()
+        && (!codes
+            || (c->codes->size() == size_t(codes->size())
+                && std::equal(
+                     c->codes->begin(), c->codes->end(), codes->data())))
+        && matrix_eq(c->matrix, matrix) && matrix_eq(c->ctm, ctm)
+        && c->snap == snap && c->line_width == line_width) {
+      record_stat("clip_path_cache.hit");
+    } else {
+      load_path_exact(cr_, path, &matrix);
+      clip_path_cache_ = ClipPathCache{
+        {vertices.data(), vertices.data() + vertices.size()},
+        codes
+        ? std::optional<std::vector<uint8_t>>{
+            {codes->data(), codes->data() + codes->size()}}
+        : std::nullopt,
+        matrix, ctm, snap, line_width,
+        {cairo_copy_path(cr_), cairo_path_destroy}};
+    }
     get_additional_state().clip_path =
-      {transformed_path, {cairo_copy_path(cr_), cairo_path_destroy}};
+      {transformed_path, clip_path_cache_->path};
   } else {
     get_additional_state().clip_path = {{}, {}};
   }
@@ -722,6 +1128,69 @@ rgb_t GraphicsContextRenderer::get_rgb()
   return {r, g, b};
 }
 
+PatternCache& GraphicsContextRenderer::get_pattern_cache(double threshold)
+{
+  // Stamps depend on the dpi (via the linewidths and the transforms), so
+  // would never be reused after a dpi change; drop them all at once.
+  auto const& dpi = get_additional_state().dpi;
+  if (!pattern_cache_
+      || pattern_cache_->threshold() != threshold
+      || pattern_cache_dpi_ != dpi) {
+    pattern_cache_ = std::make_shared<PatternCache>(threshold);
+    pattern_cache_dpi_ = dpi;
+  }
+  return *pattern_cache_;
+}
+
+// Return the repeating pattern to fill with the current hatch, or null if
+// there is none.  Each tile is rasterized once per hatch, hatch color, hatch
+// linewidth and dpi, so that e.g. bar charts with many identically hatched
+// bars only rasterize it once.
+cairo_pattern_t* GraphicsContextRenderer::get_hatch_pattern()
+{
+  auto& state = get_additional_state();
+  if (!state.hatch) {
+    return nullptr;
+  }
+  auto const& dpi = int(state.dpi);  // Truncating is good enough.
+  auto key = std::tuple{
+    *state.hatch, state.get_hatch_color(), state.get_hatch_linewidth(), dpi};
+  if (auto const& it = hatch_patterns_.find(key);
+      it != hatch_patterns_.end()) {
+    record_stat("hatch_cache.hit");
+    return it->second.get();
+  }
+  auto const& timed = Timed{"hatch_cache.miss"};
+  auto hatch_pattern = std::shared_ptr<cairo_pattern_t>{};
+  if (auto const& hatch_path =
+      py::cast(this).attr("get_hatch_path")()
+      .cast<std::optional<py::object>>()) {
+    auto const& hatch_surface =
+      cairo_surface_create_similar(
+        cairo_get_target(cr_), CAIRO_CONTENT_COLOR_ALPHA, dpi, dpi);
+    auto const& hatch_cr = cairo_create(hatch_surface);
+    cairo_surface_destroy(hatch_surface);
+    auto hatch_gcr = GraphicsContextRenderer{
+      hatch_cr, double(dpi), double(dpi), double(dpi)};
+    hatch_gcr.get_additional_state().snap = false;
+    hatch_gcr.set_linewidth(std::get<2>(key));
+    auto const& matrix =
+      cairo_matrix_t{double(dpi), 0, 0, -double(dpi), 0, double(dpi)};
+    auto const& hatch_color = std::get<1>(key);
+    fill_and_stroke_exact(
+      hatch_cr, *hatch_path, &matrix, hatch_color, hatch_color);
+    hatch_pattern.reset(
+      cairo_pattern_create_for_surface(cairo_get_target(hatch_cr)),
+      cairo_pattern_destroy);
+    cairo_pattern_set_extend(hatch_pattern.get(), CAIRO_EXTEND_REPEAT);
+  }
+  if (hatch_patterns_.size() >= 64) {  // NOTE: Arbitrary limit.
+    hatch_patterns_.clear();  // Naive cache mechanism.
+  }
+  return
+    hatch_patterns_.emplace(std::move(key), hatch_pattern).first->second.get();
+}
+
 GraphicsContextRenderer& GraphicsContextRenderer::new_gc()
 {
   cairo_save(cr_);
@@ -764,12 +1233,14 @@ void GraphicsContextRenderer::draw_gouraud_triangles(
   if (&gc != this) {
     throw std::invalid_argument{"non-matching GraphicsContext"};
   }
+  auto timed = Timed{stats_, "draw_gouraud_triangles"};
   auto const& ac = _additional_context();
   auto matrix =
     matrix_from_transform(transform, get_additional_state().height);
   auto const& tri_raw = triangles.unchecked<3>();
   auto const& col_raw = colors.unchecked<3>();
   auto const& n = tri_raw.shape(0);
+  timed.add_items(n);
   if (col_raw.shape(0) != n
       || tri_raw.shape(1) != 3 || tri_raw.shape(2) != 2
       || col_raw.shape(1) != 3 || col_raw.shape(2) != 4) {
@@ -794,47 +1265,14 @@ void GraphicsContextRenderer::draw_gouraud_triangles(
   cairo_pattern_set_matrix(pattern, &matrix);
   cairo_set_source(cr_, pattern);
   cairo_pattern_destroy(pattern);
+  auto const& nogil = ReleaseGIL{};
   cairo_paint(cr_);
 }
 
-void GraphicsContextRenderer::draw_image(
-  GraphicsContextRenderer& gc, double x, double y, py::array_t<uint8_t> im)
+// With svg.image_inline = False, write `surface` to a file next to the SVG
+// output and reference it by URI, as Matplotlib does.
+void GraphicsContextRenderer::write_svg_image(cairo_surface_t* surface)
 {
-  if (&gc != this) {
-    throw std::invalid_argument{"non-matching GraphicsContext"};
-  }
-  auto const& ac = _additional_context();
-  auto const& im_raw = im.unchecked<3>();
-  auto const& height = im_raw.shape(0), width = im_raw.shape(1);
-  if (im_raw.shape(2) != 4) {
-    throw std::invalid_argument{
-      "RGBA array must have shape (m, n, 4), not {.shape}"_format(im)
-      .cast<std::string>()};
-  }
-  // Let cairo manage the surface memory; as some backends only write the image
-  // at flush time.
-  auto const& surface =
-    cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
-  auto const& data = cairo_image_surface_get_data(surface);
-  auto const& stride = cairo_image_surface_get_stride(surface);
-  cairo_surface_flush(surface);
-  // The gcr's alpha has already been applied by ImageBase._make_image, we just
-  // need to convert to premultiplied ARGB format.
-  for (auto i = 0; i < height; ++i) {
-    auto ptr = reinterpret_cast<uint32_t*>(data + i * stride);
-    for (auto j = 0; j < width; ++j) {
-      auto const& r = im_raw(i, j, 0),
-                & g = im_raw(i, j, 1),
-                & b = im_raw(i, j, 2),
-                & a = im_raw(i, j, 3);
-      *(ptr++) =
-        (uint8_t(a) << 24)
-        | (uint8_t(a / 255. * r) << 16)
-        | (uint8_t(a / 255. * g) << 8)
-        | (uint8_t(a / 255. * b) << 0);
-    }
-  }
-  cairo_surface_mark_dirty(surface);
   if (cairo_surface_get_type(cairo_get_target(cr_)) == CAIRO_SURFACE_TYPE_SVG
       && !rc_param("svg.image_inline").cast<bool>()) {
     if (!path_) {
@@ -864,6 +1302,49 @@ void GraphicsContextRenderer::draw_image(
       },
       image_path_ptr);
   }
+}
+
+void GraphicsContextRenderer::draw_image(
+  GraphicsContextRenderer& gc, double x, double y, py::array_t<uint8_t> im)
+{
+  if (&gc != this) {
+    throw std::invalid_argument{"non-matching GraphicsContext"};
+  }
+  auto timed = Timed{stats_, "draw_image"};
+  auto const& ac = _additional_context();
+  if (im.ndim() != 3 || im.shape(2) != 4) {
+    throw std::invalid_argument{
+      "RGBA array must have shape (m, n, 4), not {.shape}"_format(im)
+      .cast<std::string>()};
+  }
+  // The premultiplication kernel requires pixels to be contiguous within each
+  // row.
+  if (im.strides(2) != 1 || im.strides(1) != 4) {
+    im =
+      py::module::import("numpy").attr("ascontiguousarray")(im)
+      .cast<py::array_t<uint8_t>>();
+  }
+  auto const& height = im.shape(0), width = im.shape(1);
+  timed.add_items(height * width);
+  // Let cairo manage the surface memory; as some backends only write the image
+  // at flush time.
+  auto const& surface =
+    cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+  auto const& data = cairo_image_surface_get_data(surface);
+  auto const& stride = cairo_image_surface_get_stride(surface);
+  cairo_surface_flush(surface);
+  // The gcr's alpha has already been applied by ImageBase._make_image, we just
+  // need to convert to premultiplied ARGB format.
+  {
+    auto const& nogil = ReleaseGIL{};
+    auto const& im_data = im.data();
+    for (auto i = 0; i < height; ++i) {
+      premultiply_rgba8888(
+        im_data + i * im.strides(0), data + i * stride, width);
+    }
+  }
+  cairo_surface_mark_dirty(surface);
+  write_svg_image(surface);
   auto const& pattern = cairo_pattern_create_for_surface(surface);
   cairo_surface_destroy(surface);
   auto const& matrix =
@@ -871,9 +1352,293 @@ void GraphicsContextRenderer::draw_image(
   cairo_pattern_set_matrix(pattern, &matrix);
   cairo_set_source(cr_, pattern);
   cairo_pattern_destroy(pattern);
+  auto const& nogil = ReleaseGIL{};
   cairo_paint(cr_);
 }
 
+// Paint `buf`, an image in cairo's native format (premultiplied ARGB32, or
+// RGBA128F for float surfaces), as returned by _get_buffer (possibly sliced),
+// with its top left corner at (x, y) in (top-down) pixel coordinates.  The
+// buffer is wrapped without any copy or conversion, and kept alive for as
+// long as cairo needs it (vector surfaces may only read it when finishing
+// the page); it must not be modified afterwards.
+void GraphicsContextRenderer::_draw_cairo_buffer(
+  GraphicsContextRenderer& gc, double x, double y, py::array buf)
+{
+  if (&gc != this) {
+    throw std::invalid_argument{"non-matching GraphicsContext"};
+  }
+  auto timed = Timed{stats_, "draw_image"};
+  auto const& ac = _additional_context();
+  auto format = CAIRO_FORMAT_INVALID;
+  if (buf.ndim() == 3 && buf.shape(2) == 4) {
+    if (py::isinstance<py::array_t<uint8_t>>(buf)) {
+      format = CAIRO_FORMAT_ARGB32;
+    } else if (py::isinstance<py::array_t<float>>(buf)
+               && cairo_version() >= CAIRO_VERSION_ENCODE(1, 17, 2)) {
+      format = static_cast<cairo_format_t>(7);  // CAIRO_FORMAT_RGBA_128F.
+    }
+  }
+  auto const& height = buf.ndim() == 3 ? buf.shape(0) : 0,
+            & width = buf.ndim() == 3 ? buf.shape(1) : 0;
+  auto const& pixel_size = format == CAIRO_FORMAT_ARGB32 ? 4 : 16;
+  if (format == CAIRO_FORMAT_INVALID
+      || buf.strides(2) != pixel_size / 4 || buf.strides(1) != pixel_size
+      || buf.strides(0) % 4 || buf.strides(0) < pixel_size * width
+      || !buf.writeable()) {
+    throw std::invalid_argument{
+      "buffer must be a writeable (m, n, 4) array in a native cairo format, "
+      "with contiguous pixels, not a {.shape} array of {.dtype}"_format(
+        buf, buf).cast<std::string>()};
+  }
+  timed.add_items(height * width);
+  if (!height || !width) {
+    return;
+  }
+  auto const& surface =
+    cairo_image_surface_create_for_data(
+      static_cast<uint8_t*>(buf.mutable_data()), format,
+      width, height, buf.strides(0));
+  auto const& buf_ref = new py::object{buf};
+  CAIRO_CLEANUP_CHECK(
+    { delete buf_ref; cairo_surface_destroy(surface); },
+    cairo_surface_set_user_data,
+    surface, &detail::REFS_KEY, buf_ref,
+    [](void* data) -> void {
+      auto const& gil = py::gil_scoped_acquire{};
+      delete static_cast<py::object*>(data);
+    });
+  write_svg_image(surface);
+  auto const& pattern = cairo_pattern_create_for_surface(surface);
+  cairo_surface_destroy(surface);
+  auto const& matrix = cairo_matrix_t{1, 0, 0, 1, -x, -y};
+  cairo_pattern_set_matrix(pattern, &matrix);
+  cairo_set_source(cr_, pattern);
+  cairo_pattern_destroy(pattern);
+  auto const& nogil = ReleaseGIL{};
+  cairo_paint(cr_);
+}
+
+// Colormap, premultiply and resample `data`, a (m, n) float array, in a single
+// pass, without ever building a full-resolution RGBA array.  `lut` is a
+// (N + 3, 4) uint8 array of N colors followed by the "under", "over" and "bad"
+// colors (as in Colormap._lut); values are normalized linearly between `vmin`
+// and `vmax`.  `transform` maps the index space of `data` (where element
+// (i, j) covers [j, j + 1] x [i, i + 1]) to display space.  On image surfaces
+// with a translation CTM, each output pixel directly samples `data` (with rows
+// split across marker_threads threads, if set); otherwise, the colormapped
+// array is painted through a filtered pattern.
+void GraphicsContextRenderer::draw_colormapped_image(
+  GraphicsContextRenderer& gc,
+  py::array data, py::array_t<uint8_t> lut, double vmin, double vmax,
+  py::object transform, std::string interpolation)
+{
+  if (&gc != this) {
+    throw std::invalid_argument{"non-matching GraphicsContext"};
+  }
+  auto timed = Timed{stats_, "draw_colormapped_image"};
+  auto const& ac = _additional_context();
+  if (data.ndim() != 2) {
+    throw std::invalid_argument{
+      "data must have shape (m, n), not {.shape}"_format(data)
+      .cast<std::string>()};
+  }
+  if (data.dtype().kind() != 'f'
+      || (data.itemsize() != 4 && data.itemsize() != 8)) {
+    throw std::invalid_argument{
+      "data must be a float32 or float64 array, not {.dtype}"_format(data)
+      .cast<std::string>()};
+  }
+  if (lut.ndim() != 2 || lut.shape(0) < 4 || lut.shape(1) != 4) {
+    throw std::invalid_argument{
+      "lut must have shape (N + 3, 4), not {.shape}"_format(lut)
+      .cast<std::string>()};
+  }
+  auto const& bilinear = interpolation == "bilinear";
+  if (!bilinear && interpolation != "nearest") {
+    throw std::invalid_argument{"invalid interpolation: " + interpolation};
+  }
+  if (vmin > vmax) {  // As in Normalize.process_value.
+    throw std::invalid_argument{
+      "minvalue must be less than or equal to maxvalue"};
+  }
+  auto const& rows = data.shape(0), cols = data.shape(1);
+  timed.add_items(rows * cols);
+  if (!rows || !cols) {
+    return;
+  }
+  auto const& n_colors = lut.shape(0) - 3;
+  auto const& lut_raw = lut.unchecked<2>();
+  auto argb32_lut = std::vector<uint32_t>(n_colors + 3);
+  for (auto k = 0; k < n_colors + 3; ++k) {
+    auto const& r = lut_raw(k, 0), g = lut_raw(k, 1), b = lut_raw(k, 2),
+                a = lut_raw(k, 3);
+    argb32_lut[k] =
+      (uint32_t(a) << 24)
+      | (uint32_t((r * a + 127) / 255) << 16)
+      | (uint32_t((g * a + 127) / 255) << 8)
+      | (uint32_t((b * a + 127) / 255) << 0);
+  }
+  auto const& matrix =
+    matrix_from_transform(transform, get_additional_state().height);
+  auto inverse = matrix;
+  if (cairo_matrix_invert(&inverse) != CAIRO_STATUS_SUCCESS) {
+    return;  // Degenerate transform, nothing to draw.
+  }
+  auto const& base = static_cast<char const*>(data.data());
+  auto const& stride0 = data.strides(0), stride1 = data.strides(1);
+  auto const& is_float32 = data.itemsize() == 4;
+  auto const& value = [&](ssize_t i, ssize_t j) -> double {
+    auto const& ptr = base + i * stride0 + j * stride1;
+    return
+      is_float32
+      ? *reinterpret_cast<float const*>(ptr)
+      : *reinterpret_cast<double const*>(ptr);
+  };
+  // Normalize.  As in Colormap.__call__, the top of the range maps to the
+  // last color; a degenerate range maps everything to the first color.
+  auto const& scale = vmax > vmin ? n_colors / (vmax - vmin) : 0.;
+  auto const& color = [&](double v) -> uint32_t {
+    if (std::isnan(v)) {
+      return argb32_lut[n_colors + 2];
+    }
+    auto const& x = (v - vmin) * scale;
+    if (!(x >= 0)) {
+      return argb32_lut[n_colors];
+    } else if (x > n_colors) {
+      return argb32_lut[n_colors + 1];
+    } else {
+      return argb32_lut[std::min(ssize_t(x), n_colors - 1)];
+    }
+  };
+  // Sample at (u, v), in index space.
+  auto const& sample = [&](double u, double v) -> uint32_t {
+    if (!(0 <= u && u < cols && 0 <= v && v < rows)) {
+      return 0;
+    }
+    if (!bilinear) {
+      return color(value(ssize_t(v), ssize_t(u)));
+    }
+    // Interpolate data (not colors) between the centers of the elements,
+    // clamping at the edges.
+    auto const& x = u - .5, y = v - .5;
+    auto const& fj = std::floor(x), fi = std::floor(y);
+    auto const& dx = x - fj, dy = y - fi;
+    auto const& j0 = std::clamp<ssize_t>(ssize_t(fj), 0, cols - 1),
+                j1 = std::clamp<ssize_t>(ssize_t(fj) + 1, 0, cols - 1),
+                i0 = std::clamp<ssize_t>(ssize_t(fi), 0, rows - 1),
+                i1 = std::clamp<ssize_t>(ssize_t(fi) + 1, 0, rows - 1);
+    return color(
+      (1 - dy) * ((1 - dx) * value(i0, j0) + dx * value(i0, j1))
+      + dy * ((1 - dx) * value(i1, j0) + dx * value(i1, j1)));
+  };
+  // Generic on to_index, so that it gets inlined in the per-pixel loop.
+  auto const& fill = [&](
+    uint8_t* out, int out_stride, ssize_t start, ssize_t stop, int width,
+    auto const& to_index) -> void {
+    for (auto r = start; r < stop; ++r) {
+      auto const& row = reinterpret_cast<uint32_t*>(out + r * out_stride);
+      for (auto c = 0; c < width; ++c) {
+        auto const& [u, v] = to_index(c, r);
+        row[c] = sample(u, v);
+      }
+    }
+  };
+  auto const& fill_threaded = [&](
+    cairo_surface_t* surface, auto const& to_index) -> void {
+    auto const& out = cairo_image_surface_get_data(surface);
+    auto const& out_stride = cairo_image_surface_get_stride(surface);
+    auto const& width = cairo_image_surface_get_width(surface),
+              & height = cairo_image_surface_get_height(surface);
+    auto const& n_threads = detail::MARKER_THREADS;
+    auto const& nogil = ReleaseGIL{};
+    cairo_surface_flush(surface);
+    if (n_threads > 1 && height > 1) {
+      auto const& chunk_size = (height + n_threads - 1) / n_threads;
+      auto threads = std::vector<std::thread>{};
+      for (auto start = 0; start < height; start += chunk_size) {
+        threads.emplace_back([&, start] {
+          fill(
+            out, out_stride, start, std::min(start + chunk_size, height),
+            width, to_index);
+        });
+      }
+      for (auto& thread: threads) {
+        thread.join();
+      }
+    } else {
+      fill(out, out_stride, 0, height, width, to_index);
+    }
+    cairo_surface_mark_dirty(surface);
+  };
+  auto const& alpha = get_additional_state().alpha.value_or(1);
+  auto const& target = cairo_get_group_target(cr_);
+  double tx = 0, ty = 0, x1 = 1, y1 = 0, x2 = 0, y2 = 1;
+  cairo_user_to_device(cr_, &tx, &ty);
+  cairo_user_to_device(cr_, &x1, &y1);
+  cairo_user_to_device(cr_, &x2, &y2);
+  if (cairo_surface_get_type(target) == CAIRO_SURFACE_TYPE_IMAGE
+      && x1 - tx == 1 && y1 - ty == 0 && x2 - tx == 0 && y2 - ty == 1) {
+    // Only resample the part of the image that is within the clip.
+    double bx0, by0, bx1, by1;
+    cairo_clip_extents(cr_, &bx0, &by0, &bx1, &by1);
+    auto ix0 = std::numeric_limits<double>::infinity(), iy0 = ix0,
+         ix1 = -ix0, iy1 = -ix0;
+    auto const& w = double(cols), h = double(rows);
+    for (auto const& [cx, cy]: {
+           std::tuple{0., 0.}, std::tuple{w, 0.},
+           std::tuple{0., h}, std::tuple{w, h}}) {
+      auto x = cx, y = cy;
+      cairo_matrix_transform_point(&matrix, &x, &y);
+      ix0 = std::min(ix0, x); ix1 = std::max(ix1, x);
+      iy0 = std::min(iy0, y); iy1 = std::max(iy1, y);
+    }
+    auto const& c0 = int(std::max(std::floor(std::max(ix0, bx0) + tx), 0.)),
+              & r0 = int(std::max(std::floor(std::max(iy0, by0) + ty), 0.)),
+              & c1 = int(std::min(
+                  std::ceil(std::min(ix1, bx1) + tx),
+                  double(cairo_image_surface_get_width(target)))),
+              & r1 = int(std::min(
+                  std::ceil(std::min(iy1, by1) + ty),
+                  double(cairo_image_surface_get_height(target))));
+    if (!(c0 < c1 && r0 < r1)) {
+      return;
+    }
+    auto const& surface =
+      cairo_image_surface_create(CAIRO_FORMAT_ARGB32, c1 - c0, r1 - r0);
+    fill_threaded(surface, [&](int c, int r) -> std::tuple<double, double> {
+      // Pixel centers, in user space, then in index space.
+      auto u = c0 + c + .5 - tx, v = r0 + r + .5 - ty;
+      cairo_matrix_transform_point(&inverse, &u, &v);
+      return {u, v};
+    });
+    cairo_save(cr_);
+    cairo_identity_matrix(cr_);
+    cairo_set_source_surface(cr_, surface, c0, r0);
+    cairo_surface_destroy(surface);
+    auto const& nogil = ReleaseGIL{};
+    cairo_paint_with_alpha(cr_, alpha);
+    cairo_restore(cr_);
+  } else {
+    // Let cairo manage the surface memory, as some backends only write the
+    // image at flush time.
+    auto const& surface =
+      cairo_image_surface_create(CAIRO_FORMAT_ARGB32, cols, rows);
+    fill_threaded(surface, [&](int c, int r) -> std::tuple<double, double> {
+      return {c + .5, r + .5};
+    });
+    auto const& pattern = cairo_pattern_create_for_surface(surface);
+    cairo_surface_destroy(surface);
+    cairo_pattern_set_matrix(pattern, &inverse);
+    cairo_pattern_set_filter(
+      pattern, bilinear ? CAIRO_FILTER_BILINEAR : CAIRO_FILTER_NEAREST);
+    cairo_set_source(cr_, pattern);
+    cairo_pattern_destroy(pattern);
+    auto const& nogil = ReleaseGIL{};
+    cairo_paint_with_alpha(cr_, alpha);
+  }
+}
+
 void GraphicsContextRenderer::draw_markers(
   GraphicsContextRenderer& gc,
   py::object marker_path,
@@ -885,6 +1650,7 @@ void GraphicsContextRenderer::draw_markers(
   if (&gc != this) {
     throw std::invalid_argument{"non-matching GraphicsContext"};
   }
+  auto timed = Timed{stats_, "draw_markers"};
   auto const& ac = _additional_context();
 
   // As paths store their vertices in an array, the .cast<>() will not make a
@@ -894,6 +1660,7 @@ void GraphicsContextRenderer::draw_markers(
   // FIXME[matplotlib]: For efficiency, we ignore codes, which is the
   // documented behavior even though not the actual one of other backends.
   auto const& n_vertices = vertices.shape(0);
+  timed.add_items(n_vertices);
 
   auto const& marker_matrix = matrix_from_transform(marker_transform);
   auto const& matrix =
@@ -909,6 +1676,8 @@ void GraphicsContextRenderer::draw_markers(
       marker_matrix.x0 + x, marker_matrix.y0 + y};
     fill_and_stroke_exact(cr, marker_path, &m, fc_raw_opt, ec_raw);
   };
+  // Markers entirely outside of the clip (e.g. in zoomed-in views) are culled.
+  auto const& bounds = get_cull_bounds(cr_);
 
   // Pixel markers *must* be drawn snapped.
   auto const& is_pixel_marker =
@@ -982,62 +1751,52 @@ void GraphicsContextRenderer::draw_markers(
       }
     }
 
-    auto worker = [&](cairo_t* ctx, int start, int stop) {
-      for (auto i = start; i < stop; ++i) {
-        auto x = vertices(i, 0), y = vertices(i, 1);
-        cairo_matrix_transform_point(&matrix, &x, &y);
-        auto const& target_x = x + x0,
-                  & target_y = y + y0;
-        if (!(std::isfinite(target_x) && std::isfinite(target_y))) {
-          continue;
-        }
-        auto const& i_target_x = std::floor(target_x),
-                  & i_target_y = std::floor(target_y);
-        auto const& f_target_x = target_x - i_target_x,
-                  & f_target_y = target_y - i_target_y;
-        auto const& idx =
-          int(n_subpix * f_target_x) * n_subpix + int(n_subpix * f_target_y);
-        auto const& pattern = patterns[idx];
-        // Offsetting by height is already taken care of by matrix.
-        auto const& pattern_matrix =
-          cairo_matrix_t{1, 0, 0, 1, -i_target_x, -i_target_y};
-        cairo_pattern_set_matrix(pattern, &pattern_matrix);
-        cairo_set_source(ctx, pattern);
-        cairo_paint(ctx);
+    auto const& stamp_width = std::ceil(x1 - x0 + 1),
+              & stamp_height = std::ceil(y1 - y0 + 1);
+    // The items are accessed out of order, so transform them all at once.
+    auto const& xys = std::unique_ptr<double[]>{new double[2 * n_vertices]};
+    transform_vertices(vertices, 0, n_vertices, &matrix, xys.get(), nullptr);
+    auto const& target = [&](ssize_t i) -> std::tuple<double, double, int> {
+      auto const& target_x = xys[2 * i] + x0,
+                & target_y = xys[2 * i + 1] + y0;
+      if (!(std::isfinite(target_x) && std::isfinite(target_y))) {
+        return {target_x, target_y, -1};
       }
-    };
-    if (detail::MARKER_THREADS) {
-      auto const& chunk_size =
-        int(std::ceil(double(n_vertices) / detail::MARKER_THREADS));
-      auto ctxs = std::vector<cairo_t*>{};
-      auto threads = std::vector<std::thread>{};
-      for (auto i = 0; i < detail::MARKER_THREADS; ++i) {
-        auto const& surface =
-          cairo_surface_create_similar_image(
-            cairo_get_target(cr_), get_cairo_format(),
-            get_additional_state().width, get_additional_state().height);
-        auto const& ctx = cairo_create(surface);
-        cairo_surface_destroy(surface);
-        ctxs.push_back(ctx);
-        threads.emplace_back(
-          worker, ctx,
-          chunk_size * i, std::min<int>(chunk_size * (i + 1), n_vertices));
+      auto const& i_target_x = std::floor(target_x),
+                & i_target_y = std::floor(target_y);
+      if (!bounds.intersects(
+            i_target_x, i_target_y,
+            i_target_x + stamp_width, i_target_y + stamp_height)) {
+        return {i_target_x, i_target_y, -1};
       }
-      for (auto& thread: threads) {
-        thread.join();
-      }
-      for (auto const& ctx: ctxs) {
-        auto const& pattern =
-          cairo_pattern_create_for_surface(cairo_get_target(ctx));
-        cairo_destroy(ctx);
-        cairo_set_source(cr_, pattern);
-        cairo_pattern_destroy(pattern);
-        cairo_paint(cr_);
-      }
-    }
-    else {
-      worker(cr_, 0, n_vertices);
-    }
+      auto const& f_target_x = target_x - i_target_x,
+                & f_target_y = target_y - i_target_y;
+      auto const& idx =
+        int(n_subpix * f_target_x) * n_subpix + int(n_subpix * f_target_y);
+      return {i_target_x, i_target_y, idx};
+    };
+    auto const& threads_timed = Timed{"draw_threaded", size_t(n_vertices)};
+    auto const& nogil = ReleaseGIL{};
+    draw_threaded(
+      cr_, detail::MARKER_THREADS, n_vertices,
+      [&](ssize_t i) -> std::tuple<double, double> {
+        // Binding by reference results in dangling reference.
+        auto const y = std::get<1>(target(i));
+        return {y, y + stamp_height};
+      },
+      [&](cairo_t* ctx, ssize_t i) -> void {
+        auto const& [x, y, idx] = target(i);
+        if (idx < 0) {
+          return;
+        }
+        // Don't modify the shared pattern's matrix, as the items may be
+        // drawn in parallel.  Offsetting by height is already taken care of
+        // by matrix.
+        cairo_surface_t* surface;
+        cairo_pattern_get_surface(patterns[idx], &surface);
+        cairo_set_source_surface(ctx, surface, x, y);
+        cairo_paint(ctx);
+      });
 
     // Cleanup.
     for (auto i = 0; i < n_subpix * n_subpix; ++i) {
@@ -1052,25 +1811,51 @@ void GraphicsContextRenderer::draw_markers(
     auto const& fc_argb32 = uint32_t(
         (uint8_t(255 * a) << 24) | (uint8_t(255 * a * r) << 16)
         | (uint8_t(255 * a * g) << 8) | (uint8_t(255 * a * b)));
+    // Culling also prevents writing out of the buffer's bounds.
+    auto const& width = cairo_image_surface_get_width(surface),
+              & height = cairo_image_surface_get_height(surface);
+    auto const& nogil = ReleaseGIL{};
+    auto transformed = TransformedVertices{vertices, &matrix};
     cairo_surface_flush(surface);
     for (auto i = 0; i < n_vertices; ++i) {
-      auto x = vertices(i, 0), y = vertices(i, 1);
-      cairo_matrix_transform_point(&matrix, &x, &y);
-      if (!(std::isfinite(x) && std::isfinite(y))) {
+      auto const& [x, y, is_finite] = transformed(i);
+      if (!is_finite) {
+        continue;
+      }
+      auto const& i_x = std::lround(x), & i_y = std::lround(y);
+      if (!(0 <= i_x && i_x < width && 0 <= i_y && i_y < height
+            && bounds.intersects(i_x, i_y, i_x + 1, i_y + 1))) {
         continue;
       }
       // FIXME: Correctly apply alpha.
-      *reinterpret_cast<uint32_t*>(
-        raw + std::lround(y) * stride + 4 * std::lround(x)) = fc_argb32;
+      *reinterpret_cast<uint32_t*>(raw + i_y * stride + 4 * i_x) = fc_argb32;
     }
     cairo_surface_mark_dirty(surface);
 
   } else {
+    // The marker extents, relative to its position (if culling applies).
+    auto const& inf = std::numeric_limits<double>::infinity();
+    double x0 = -inf, y0 = -inf, x1 = inf, y1 = inf;
+    if (std::isfinite(bounds.x0)) {
+      load_path_exact(cr_, marker_path, &marker_matrix);
+      cairo_stroke_extents(cr_, &x0, &y0, &x1, &y1);
+      if (fc) {
+        double x0f, y0f, x1f, y1f;
+        cairo_fill_extents(cr_, &x0f, &y0f, &x1f, &y1f);
+        x0 = std::min(x0, x0f);
+        y0 = std::min(y0, y0f);
+        x1 = std::max(x1, x1f);
+        y1 = std::max(y1, y1f);
+      }
+      cairo_new_path(cr_);
+      // Leave a margin for snapping.
+      x0 -= 1; y0 -= 1; x1 += 1; y1 += 1;
+    }
+    auto transformed = TransformedVertices{vertices, &matrix};
     for (auto i = 0; i < n_vertices; ++i) {
       cairo_save(cr_);
-      auto x = vertices(i, 0), y = vertices(i, 1);
-      cairo_matrix_transform_point(&matrix, &x, &y);
-      if (!(std::isfinite(x) && std::isfinite(y))) {
+      auto const& [x, y, is_finite] = transformed(i);
+      if (!is_finite || !bounds.intersects(x + x0, y + y0, x + x1, y + y1)) {
         cairo_restore(cr_);
         continue;
       }
@@ -1089,6 +1874,7 @@ void GraphicsContextRenderer::draw_path(
   if (&gc != this) {
     throw std::invalid_argument{"non-matching GraphicsContext"};
   }
+  auto const& timed = Timed{stats_, "draw_path"};
   auto const& ac = _additional_context();
   auto path_loaded = false;
   auto matrix =
@@ -1110,48 +1896,43 @@ void GraphicsContextRenderer::draw_path(
     cairo_save(cr_);
     auto const& [r, g, b, a] = to_rgba(*fc, get_additional_state().alpha);
     cairo_set_source_rgba(cr_, r, g, b, a);
-    cairo_fill_preserve(cr_);
+    {
+      auto const& nogil = ReleaseGIL{};
+      cairo_fill_preserve(cr_);
+    }
     cairo_restore(cr_);
   }
-  if (auto const& hatch_path =
-      py::cast(this).attr("get_hatch_path")()
-      .cast<std::optional<py::object>>()) {
+  if (auto const& hatch_pattern = get_hatch_pattern()) {
     cairo_save(cr_);
-    auto const& dpi = int(get_additional_state().dpi);  // Truncating is good enough.
-    auto const& hatch_surface =
-      cairo_surface_create_similar(
-        cairo_get_target(cr_), CAIRO_CONTENT_COLOR_ALPHA, dpi, dpi);
-    auto const& hatch_cr = cairo_create(hatch_surface);
-    cairo_surface_destroy(hatch_surface);
-    auto hatch_gcr = GraphicsContextRenderer{
-      hatch_cr, double(dpi), double(dpi), double(dpi)};
-    hatch_gcr.get_additional_state().snap = false;
-    hatch_gcr.set_linewidth(get_additional_state().get_hatch_linewidth());
-    auto const& matrix =
-      cairo_matrix_t{double(dpi), 0, 0, -double(dpi), 0, double(dpi)};
-    auto const& hatch_color = get_additional_state().get_hatch_color();
-    fill_and_stroke_exact(
-      hatch_cr, *hatch_path, &matrix, hatch_color, hatch_color);
-    auto const& hatch_pattern =
-      cairo_pattern_create_for_surface(cairo_get_target(hatch_cr));
-    cairo_pattern_set_extend(hatch_pattern, CAIRO_EXTEND_REPEAT);
     cairo_set_source(cr_, hatch_pattern);
-    cairo_pattern_destroy(hatch_pattern);
     load_path();
     cairo_clip_preserve(cr_);
-    cairo_paint(cr_);
+    {
+      auto const& nogil = ReleaseGIL{};
+      cairo_paint(cr_);
+    }
     cairo_restore(cr_);
   }
   auto const& chunksize = rc_param("agg.path.chunksize").cast<int>();
-  if (path_loaded || !chunksize || !path.attr("codes").is_none()) {
+  // Decimation and culling (of the segments outside of the clip) would shift
+  // dash patterns, and are pointless in vector outputs.
+  auto const& cull =
+    !get_additional_state().sketch
+    && !has_vector_surface(cr_) && !cairo_get_dash_count(cr_);
+  auto const& decimate = cull && detail::PATH_DECIMATION;
+  if (path_loaded || !(chunksize || cull)
+      || !path.attr("codes").is_none()) {
     load_path();
+    auto const& nogil = ReleaseGIL{};
     cairo_stroke(cr_);
   } else {
     auto const& vertices = path.attr("vertices").cast<py::array_t<double>>();
     auto const& n = vertices.shape(0);
-    for (auto i = decltype(n)(0); i < n; i += chunksize) {
+    auto const& step = chunksize ? decltype(n)(chunksize) : n;
+    for (auto i = decltype(n)(0); i < n; i += step) {
       load_path_exact(
-        cr_, vertices, i, std::min(i + chunksize + 1, n), &matrix);
+        cr_, vertices, i, std::min(i + step + 1, n), &matrix, decimate, cull);
+      auto const& nogil = ReleaseGIL{};
       cairo_stroke(cr_);
     }
   }
@@ -1173,20 +1954,14 @@ void GraphicsContextRenderer::draw_path_collection(
   py::object urls,
   std::string offset_position)
 {
-  // TODO: Persistent cache; cache eviction policy.
-
   // Fall back onto the slow implementation in the following, non-supported
-  // cases:
-  // - Hatching is used: the stamp cache cannot be used anymore, as the hatch
-  //   positions would be different on every stamp.  (NOTE: Actually it may be
-  //   possible to use the hatch as the source and mask it with the pattern.)
+  // case:
   // - FIXME[matplotlib]: offset_position is set to "data".  This feature
   //   is only used by hexbin(), so it should really just be deprecated;
   //   hexbin() should provide its own Container class which correctly adjusts
   //   the transforms at draw time (or just be drawn as a quadmesh, see
   //   draw_quad_mesh).
-  if (py::bool_(py::cast(this).attr("get_hatch")())
-      || offset_position == "data") {
+  if (offset_position == "data") {
     py::module::import("matplotlib.backend_bases")
       .attr("RendererBase").attr("draw_path_collection")(
         this, gc, master_transform,
@@ -1198,6 +1973,7 @@ void GraphicsContextRenderer::draw_path_collection(
   if (&gc != this) {
     throw std::invalid_argument{"non-matching GraphicsContext"};
   }
+  auto timed = Timed{stats_, "draw_path_collection"};
   auto const& ac = _additional_context();
   auto const& old_snap = get_additional_state().snap;
   get_additional_state().snap = false;
@@ -1206,6 +1982,7 @@ void GraphicsContextRenderer::draw_path_collection(
        n_transforms = ssize_t(transforms.size()),
        n_offsets = offsets.shape(0),
        n = std::max({n_paths, n_transforms, n_offsets});
+  timed.add_items(n);
   if (!n_paths || !n_offsets) {
     return;
   }
@@ -1228,15 +2005,17 @@ void GraphicsContextRenderer::draw_path_collection(
       .cast<std::string>()};
   }
   auto const& offset_matrix = matrix_from_transform(offset_transform);
-  auto const& convert_colors = [&](py::object colors) -> py::array_t<double> {
-    auto const& alpha = get_additional_state().alpha;
-    return
-      py::module::import("matplotlib.colors").attr("to_rgba_array")(
-        colors, alpha ? py::cast(*alpha) : py::none());
-  };
+  auto const& offsets_xys =
+    std::unique_ptr<double[]>{new double[2 * n_offsets]};
+  auto const& offsets_finite = std::unique_ptr<bool[]>{new bool[n_offsets]};
+  transform_vertices(
+    offsets_raw, 0, n_offsets, &offset_matrix,
+    offsets_xys.get(), offsets_finite.get());
   // Don't drop the arrays until the function exits.
-  auto const& fcs_raw_keepref = convert_colors(fcs),
-              ecs_raw_keepref = convert_colors(ecs);
+  auto const& fcs_raw_keepref =
+                to_rgba_array(fcs, get_additional_state().alpha),
+              ecs_raw_keepref =
+                to_rgba_array(ecs, get_additional_state().alpha);
   auto const& fcs_raw = fcs_raw_keepref.unchecked<2>(),
               ecs_raw = ecs_raw_keepref.unchecked<2>();
   auto const& lws_raw = lws.unchecked<1>();
@@ -1256,38 +2035,115 @@ void GraphicsContextRenderer::draw_path_collection(
   auto const& simplify_threshold =
     has_vector_surface(cr_)
     ? 0 : rc_param("path.simplify_threshold").cast<double>();
-  auto cache = PatternCache{simplify_threshold};
-  // FIXME: Implement parallelization.
+  auto& cache = get_pattern_cache(simplify_threshold);
+  // With marker_threads, stamps are looked up (and rasterized if needed)
+  // serially, as this may call into Python, but are queued to be masked onto
+  // the canvas in parallel (see draw_threaded).  The queue must be flushed
+  // before something gets drawn directly, to preserve the drawing order.
+  auto const& threaded = detail::MARKER_THREADS && !has_vector_surface(cr_);
+  // The clip is constant over the call (hatching restores it), so the cull
+  // bounds only need to be computed once.
+  auto const& bounds = get_cull_bounds(cr_);
+  auto queue = std::vector<std::tuple<PatternCache::Stamp, rgba_t>>{};
+  auto const& flush = [&]() -> void {
+    auto const& timed = Timed{"draw_threaded", queue.size()};
+    auto const& nogil = ReleaseGIL{};
+    draw_threaded(
+      cr_, detail::MARKER_THREADS, queue.size(),
+      [&](ssize_t i) -> std::tuple<double, double> {
+        auto const& stamp = std::get<0>(queue[i]);
+        cairo_surface_t* surface;
+        cairo_pattern_get_surface(stamp.pattern, &surface);
+        return {stamp.y, stamp.y + cairo_image_surface_get_height(surface)};
+      },
+      [&](cairo_t* ctx, ssize_t i) -> void {
+        auto const& [stamp, color] = queue[i];
+        auto const& [r, g, b, a] = color;
+        cairo_surface_t* surface;
+        cairo_pattern_get_surface(stamp.pattern, &surface);
+        cairo_set_source_rgba(ctx, r, g, b, a);
+        cairo_mask_surface(ctx, surface, stamp.x, stamp.y);
+      });
+    queue.clear();
+  };
+  auto const& mask = [&](
+    py::object path, cairo_matrix_t const& matrix,
+    draw_func_t draw_func, double lw, dash_t dash,
+    double x, double y, rgba_t color) -> void {
+    auto const& [r, g, b, a] = color;
+    if (!threaded) {
+      cairo_set_source_rgba(cr_, r, g, b, a);
+      cache.mask(cr_, bounds, path, matrix, draw_func, lw, dash, x, y);
+    } else if (auto const& stamp =
+                 cache.get_stamp(
+                   cr_, bounds, path, matrix, draw_func, lw, dash, x, y)) {
+      if (!stamp->pattern) {
+        return;
+      }
+      queue.emplace_back(*stamp, color);
+      if (queue.size() >= 1 << 20) {  // Bound the queue's memory use.
+        flush();
+      }
+    } else {
+      flush();
+      cairo_set_source_rgba(cr_, r, g, b, a);
+      cache.draw_direct(cr_, path, matrix, draw_func, lw, dash, x, y);
+    }
+  };
+  // As in the generic implementation (which calls draw_path), each path is
+  // hatched between its fill and its stroke, using the hatch as source and the
+  // path as clip (which cannot be stamped).
+  auto const& hatch_pattern = get_hatch_pattern();
   for (auto i = 0; i < n; ++i) {
     auto const& path = paths[i % n_paths];
     auto const& matrix = matrices[i % n_transforms];
-    auto x = offsets_raw(i % n_offsets, 0), y = offsets_raw(i % n_offsets, 1);
-    cairo_matrix_transform_point(&offset_matrix, &x, &y);
-    if (!(std::isfinite(x) && std::isfinite(y))) {
+    auto const& i_offset = i % n_offsets;
+    if (!offsets_finite[i_offset]) {
       continue;
     }
+    auto const& x = offsets_xys[2 * i_offset],
+              & y = offsets_xys[2 * i_offset + 1];
     if (fcs_raw.shape(0)) {
       auto const& i_mod = i % fcs_raw.shape(0);
-      cairo_set_source_rgba(
-        cr_, fcs_raw(i_mod, 0), fcs_raw(i_mod, 1),
-             fcs_raw(i_mod, 2), fcs_raw(i_mod, 3));
-      cache.mask(cr_, path, matrix, draw_func_t::Fill, 0, {}, x, y);
+      mask(
+        path, matrix, draw_func_t::Fill, 0, {}, x, y,
+        {fcs_raw(i_mod, 0), fcs_raw(i_mod, 1),
+         fcs_raw(i_mod, 2), fcs_raw(i_mod, 3)});
+    }
+    if (hatch_pattern) {
+      if (!queue.empty()) {
+        flush();
+      }
+      auto const& m = cairo_matrix_t{
+        matrix.xx, matrix.yx, matrix.xy, matrix.yy,
+        matrix.x0 + x, matrix.y0 + y};
+      cairo_save(cr_);
+      load_path_exact(cr_, path, &m);
+      cairo_clip(cr_);
+      cairo_set_source(cr_, hatch_pattern);
+      {
+        auto const& nogil = ReleaseGIL{};
+        cairo_paint(cr_);
+      }
+      cairo_restore(cr_);
     }
     if (ecs_raw.size()) {
       auto const& i_mod = i % ecs_raw.shape(0);
-      cairo_set_source_rgba(
-        cr_, ecs_raw(i_mod, 0), ecs_raw(i_mod, 1),
-             ecs_raw(i_mod, 2), ecs_raw(i_mod, 3));
       auto const& lw = lws_raw.size()
         ? points_to_pixels(lws_raw[i % lws_raw.size()])
         : cairo_get_line_width(cr_);
       auto const& dash = dashes_raw[i % n_dashes];
-      cache.mask(cr_, path, matrix, draw_func_t::Stroke, lw, dash, x, y);
+      mask(
+        path, matrix, draw_func_t::Stroke, lw, dash, x, y,
+        {ecs_raw(i_mod, 0), ecs_raw(i_mod, 1),
+         ecs_raw(i_mod, 2), ecs_raw(i_mod, 3)});
     }
     // NOTE: We drop antialiaseds because that just seems silly.
     // We drop urls as they should be handled in a post-processing step anyways
     // (cairo doesn't seem to support them?).
   }
+  flush();
+  cache.trim(detail::PATTERN_CACHE_BYTES);
 
   get_additional_state().snap = old_snap;
 }
@@ -1314,6 +2170,8 @@ void GraphicsContextRenderer::draw_quad_mesh(
   if (&gc != this) {
     throw std::invalid_argument{"non-matching GraphicsContext"};
   }
+  auto const& timed =
+    Timed{stats_, "draw_quad_mesh", size_t(mesh_width * mesh_height)};
   auto const& ac = _additional_context();
   auto const& matrix =
     matrix_from_transform(master_transform, get_additional_state().height);
@@ -1337,22 +2195,29 @@ void GraphicsContextRenderer::draw_quad_mesh(
       "non-trivial offset\n{}\nis not supported"_format(offsets)
       .cast<std::string>()};
   }
-  auto coords_raw_keepref =  // Let numpy manage the buffer.
-    coordinates.attr("copy")().cast<py::array_t<double>>();
-  auto coords_raw = coords_raw_keepref.mutable_unchecked<3>();
+  // Transform the coordinates row by row (rows are contiguous in the common
+  // case), directly into a (mesh_height + 1, mesh_width + 1, 2) buffer.
+  auto const& coords_in = coordinates.unchecked<3>();
+  auto const& coords_buf = std::unique_ptr<double[]>{
+    new double[2 * (mesh_height + 1) * (mesh_width + 1)]};
+  auto const& coords_raw = [&](ssize_t i, ssize_t j, ssize_t k) -> double& {
+    return coords_buf[2 * (i * (mesh_width + 1) + j) + k];
+  };
+  auto const& nogil = ReleaseGIL{};
   for (auto i = 0; i < mesh_height + 1; ++i) {
-    for (auto j = 0; j < mesh_width + 1; ++j) {
-      cairo_matrix_transform_point(
-        &matrix,
-        coords_raw.mutable_data(i, j, 0), coords_raw.mutable_data(i, j, 1));
-    }
+    transform_points(
+      &matrix, mesh_width + 1,
+      coords_in.data(i, 0, 0), coords_in.data(i, 0, 1),
+      mesh_width ? coords_in.data(i, 1, 0) - coords_in.data(i, 0, 0) : 2,
+      &coords_raw(i, 0, 0), nullptr);
   }
   // If edge colors are set, we need to draw the quads one at a time in
   // order to be able to draw the edges as well.  If they are not set, using
   // cairo's mesh pattern support instead avoids conflation artifacts.
   // (FIXME[matplotlib]: In fact, it may make sense to rewrite hexbin in terms
   // of quadmeshes in order to fix their long-standing issues with such
-  // artifacts.)
+  // artifacts.)  Rectilinear meshes are drawn as a single image instead (see
+  // draw_rectilinear_mesh).
   if (ecs_raw.shape(0)) {
     for (auto i = 0; i < mesh_height; ++i) {
       for (auto j = 0; j < mesh_width; ++j) {
@@ -1375,33 +2240,78 @@ void GraphicsContextRenderer::draw_quad_mesh(
         cairo_stroke(cr_);
       }
     }
-  } else {
-    auto const& pattern = cairo_pattern_create_mesh();
-    for (auto i = 0; i < mesh_height; ++i) {
-      for (auto j = 0; j < mesh_width; ++j) {
-        cairo_mesh_pattern_begin_patch(pattern);
-        cairo_mesh_pattern_move_to(
-          pattern, coords_raw(i, j, 0), coords_raw(i, j, 1));
-        cairo_mesh_pattern_line_to(
-          pattern, coords_raw(i, j + 1, 0), coords_raw(i, j + 1, 1));
-        cairo_mesh_pattern_line_to(
-          pattern, coords_raw(i + 1, j + 1, 0), coords_raw(i + 1, j + 1, 1));
-        cairo_mesh_pattern_line_to(
-          pattern, coords_raw(i + 1, j, 0), coords_raw(i + 1, j, 1));
-        auto const& n = i * mesh_width + j;
-        auto const& r = fcs_raw(n, 0),
-                  & g = fcs_raw(n, 1),
-                  & b = fcs_raw(n, 2),
-                  & a = fcs_raw(n, 3);
-        for (auto k = 0; k < 4; ++k) {
-          cairo_mesh_pattern_set_corner_color_rgba(pattern, k, r, g, b, a);
+  } else if (!draw_rectilinear_mesh(
+               cr_, mesh_width, mesh_height, coords_buf.get(),
+               [&](ssize_t n) -> rgba_t {
+                 return {
+                   fcs_raw(n, 0), fcs_raw(n, 1), fcs_raw(n, 2), fcs_raw(n, 3)};
+               })) {
+    // Build a mesh pattern from the quads of the given rows.
+    auto const& build_mesh = [&](
+      std::vector<ssize_t> const& rows) -> cairo_pattern_t* {
+      auto const& pattern = cairo_pattern_create_mesh();
+      for (auto const& i: rows) {
+        for (auto j = 0; j < mesh_width; ++j) {
+          cairo_mesh_pattern_begin_patch(pattern);
+          cairo_mesh_pattern_move_to(
+            pattern, coords_raw(i, j, 0), coords_raw(i, j, 1));
+          cairo_mesh_pattern_line_to(
+            pattern, coords_raw(i, j + 1, 0), coords_raw(i, j + 1, 1));
+          cairo_mesh_pattern_line_to(
+            pattern,
+            coords_raw(i + 1, j + 1, 0), coords_raw(i + 1, j + 1, 1));
+          cairo_mesh_pattern_line_to(
+            pattern, coords_raw(i + 1, j, 0), coords_raw(i + 1, j, 1));
+          auto const& n = i * mesh_width + j;
+          auto const& r = fcs_raw(n, 0),
+                    & g = fcs_raw(n, 1),
+                    & b = fcs_raw(n, 2),
+                    & a = fcs_raw(n, 3);
+          for (auto k = 0; k < 4; ++k) {
+            cairo_mesh_pattern_set_corner_color_rgba(pattern, k, r, g, b, a);
+          }
+          cairo_mesh_pattern_end_patch(pattern);
         }
-        cairo_mesh_pattern_end_patch(pattern);
       }
+      return pattern;
+    };
+    // With marker_threads, on image surfaces, each band of the canvas gets
+    // its own mesh, built from all the rows of quads that intersect it (in
+    // order), and rasterized in parallel.  As each pixel still sees all the
+    // patches covering it, there are no seams between bands.
+    auto banded = false;
+    if (detail::MARKER_THREADS) {
+      auto const& threads_timed =
+        Timed{"draw_threaded", size_t(mesh_width * mesh_height)};
+      banded = draw_banded(
+        cr_, detail::MARKER_THREADS, mesh_height,
+        [&](ssize_t i) -> std::tuple<double, double> {
+          auto y0 = std::numeric_limits<double>::infinity(), y1 = -y0;
+          for (auto const& ii: {i, i + 1}) {
+            for (auto j = 0; j < mesh_width + 1; ++j) {
+              y0 = std::min(y0, coords_raw(ii, j, 1));
+              y1 = std::max(y1, coords_raw(ii, j, 1));
+            }
+          }
+          return {y0, y1};
+        },
+        [&](cairo_t* ctx, std::vector<ssize_t> const& rows) -> void {
+          auto const& pattern = build_mesh(rows);
+          cairo_set_source(ctx, pattern);
+          cairo_pattern_destroy(pattern);
+          cairo_paint(ctx);
+        });
+    }
+    if (!banded) {
+      auto rows = std::vector<ssize_t>{};
+      for (auto i = 0; i < mesh_height; ++i) {
+        rows.push_back(i);
+      }
+      auto const& pattern = build_mesh(rows);
+      cairo_set_source(cr_, pattern);
+      cairo_pattern_destroy(pattern);
+      cairo_paint(cr_);
     }
-    cairo_set_source(cr_, pattern);
-    cairo_pattern_destroy(pattern);
-    cairo_paint(cr_);
   }
 }
 
@@ -1413,11 +2323,11 @@ void GraphicsContextRenderer::draw_text(
   if (&gc != this) {
     throw std::invalid_argument{"non-matching GraphicsContext"};
   }
+  auto const& timed = Timed{stats_, "draw_text", s.size()};
   auto const& ac = _additional_context();
   if (ismath) {
-    py::module::import("mplcairo")
-      .attr("_mathtext_parse")(s, get_additional_state().dpi, prop)
-      .cast<MathtextBackend>()._draw(*this, x, y, angle);
+    parse_mathtext(s, get_additional_state().dpi, prop)
+      ->_draw(*this, x, y, angle);
   } else {
     // Need to set the current point (otherwise later texts will just follow,
     // regardless of cairo_translate).
@@ -1432,37 +2342,175 @@ void GraphicsContextRenderer::draw_text(
     cairo_set_font_size(cr_, font_size);
     auto const& options = get_font_options();
     cairo_set_font_options(cr_, options.get());
-    auto const& gac = text_to_glyphs_and_clusters(cr_, s);
-    // While the warning below perhaps belongs logically to
+    auto const& layout = shape_text(cr_, s);
+    auto const& gac = layout->gac;
+    // While the warning perhaps belongs logically to
     // text_to_glyphs_and_clusters, we don't want to also emit the warning in
     // get_text_width_height_descent, so put it here.
-    auto bytes_pos = 0, glyphs_pos = 0;
-    for (auto i = 0; i < gac.num_clusters; ++i) {
-      auto const& cluster = gac.clusters[i];
-      auto const& next_bytes_pos = bytes_pos + cluster.num_bytes,
-                  next_glyphs_pos = glyphs_pos + cluster.num_glyphs;
-      for (auto j = glyphs_pos; j < next_glyphs_pos; ++j) {
-        if (!gac.glyphs[j].index) {
-          auto missing =
-            py::cast(s.substr(bytes_pos, cluster.num_bytes))
-            .attr("encode")("ascii", "namereplace");
-          warn_on_missing_glyph(missing.cast<std::string>());
-        }
+    warn_on_missing_glyphs(gac, s);
+    if (has_vector_surface(cr_)) {
+      cairo_show_text_glyphs(
+        cr_, s.c_str(), s.size(),
+        gac.glyphs, gac.num_glyphs,
+        gac.clusters, gac.num_clusters, gac.cluster_flags);
+    } else {  // Clusters are irrelevant; maybe go through the glyph atlas.
+      show_glyphs(cr_, gac.glyphs, gac.num_glyphs);
+      // Tick labels are unclipped, so record their ink extents (with a margin
+      // for antialiasing) rather than the whole clip as damage.
+      auto const& extents = layout->get_extents(cr_);
+      add_damage(
+        extents.x_bearing - 1, extents.y_bearing - 1,
+        extents.x_bearing + extents.width + 1,
+        extents.y_bearing + extents.height + 1);
+    }
+  }
+}
+
+// Draw many single-line, non-math texts sharing font properties, with their
+// anchors at `offsets` (in Matplotlib's, non flipped, pixel coordinates).  On
+// raster surfaces, runs of unrotated texts of the same color are sent to cairo
+// as a single glyph array; on vector surfaces, each text is still emitted
+// with its clusters, so that it remains selectable.  As for Matplotlib's Text,
+// vertical alignment uses heights and descents of at least those of "lp";
+// rotated texts are aligned as with rotation_mode="anchor", i.e. the
+// unrotated text is aligned and then rotated around its anchor.
+void GraphicsContextRenderer::draw_texts(
+  GraphicsContextRenderer& gc,
+  py::array_t<double> offsets,
+  std::vector<std::string> texts,
+  py::object prop,
+  std::optional<py::array_t<double>> angles,
+  std::optional<py::array_t<double>> colors,
+  std::string ha, std::string va)
+{
+  if (&gc != this) {
+    throw std::invalid_argument{"non-matching GraphicsContext"};
+  }
+  auto const& n = ssize_t(texts.size());
+  auto const& timed = Timed{stats_, "draw_texts", size_t(n)};
+  if (offsets.ndim() != 2 || offsets.shape(0) != n || offsets.shape(1) != 2) {
+    throw std::invalid_argument{
+      "offsets must have shape ({}, 2), not {.shape}"_format(n, offsets)
+      .cast<std::string>()};
+  }
+  if (angles && (angles->ndim() != 1 || angles->shape(0) != n)) {
+    throw std::invalid_argument{
+      "angles must have shape ({},), not {.shape}"_format(n, *angles)
+      .cast<std::string>()};
+  }
+  if (colors
+      && (colors->ndim() != 2 || colors->shape(0) != n
+          || colors->shape(1) != 4)) {
+    throw std::invalid_argument{
+      "colors must have shape ({}, 4), not {.shape}"_format(n, *colors)
+      .cast<std::string>()};
+  }
+  auto const& ha_factor =
+    ha == "left" ? 0. : ha == "center" ? .5 : ha == "right" ? 1. : NAN;
+  if (std::isnan(ha_factor)) {
+    throw std::invalid_argument{"invalid horizontal alignment: " + ha};
+  }
+  if (va != "baseline" && va != "bottom" && va != "center" && va != "top") {
+    throw std::invalid_argument{"invalid vertical alignment: " + va};
+  }
+  // Text._get_layout clamps the line metrics to those of "lp".
+  auto const& lp_metrics =
+    get_text_width_height_descent("lp", prop, py::bool_{false});
+  auto const& lp_height = std::get<1>(lp_metrics),
+            & lp_descent = std::get<2>(lp_metrics);
+  // Offset of the baseline-left point from the anchor (with y pointing down).
+  auto const& anchor_offset =
+    [&](cairo_text_extents_t const& extents) -> std::tuple<double, double> {
+      auto const& width = extents.width + extents.x_bearing,
+                & height = std::max(extents.height, lp_height),
+                & descent =
+                  std::max(extents.height + extents.y_bearing, lp_descent);
+      return {
+        -ha_factor * width,
+        va == "baseline" ? 0
+        : va == "bottom" ? -descent
+        : va == "center" ? height / 2 - descent
+        : height - descent};
+    };
+  auto const& offsets_raw = offsets.unchecked<2>();
+  auto const& ac = _additional_context();
+  auto const& font_face = font_face_from_prop(prop);
+  cairo_set_font_face(cr_, font_face);
+  cairo_font_face_destroy(font_face);
+  cairo_set_font_size(
+    cr_, points_to_pixels(prop.attr("get_size_in_points")().cast<double>()));
+  auto const& options = get_font_options();
+  cairo_set_font_options(cr_, options.get());
+  auto const& height = get_additional_state().height;
+  auto const& vector = has_vector_surface(cr_);
+  auto const& default_color = get_rgba();
+  auto glyphs = std::vector<cairo_glyph_t>{};
+  auto glyphs_color = default_color;
+  auto const& flush = [&]() -> void {
+    if (glyphs.empty()) {
+      return;
+    }
+    auto const& [r, g, b, a] = glyphs_color;
+    cairo_set_source_rgba(cr_, r, g, b, a);
+    show_glyphs(cr_, glyphs.data(), glyphs.size());
+    glyphs.clear();
+  };
+  for (auto i = 0; i < n; ++i) {
+    auto const& s = texts[i];
+    auto const& x = offsets_raw(i, 0), y = height - offsets_raw(i, 1);
+    auto const& angle = angles ? angles->at(i) : 0;
+    if (s.empty() || !std::isfinite(x) || !std::isfinite(y)
+        || !std::isfinite(angle)) {
+      continue;
+    }
+    auto const& color =
+      colors
+      ? rgba_t{colors->at(i, 0), colors->at(i, 1),
+               colors->at(i, 2), colors->at(i, 3)}
+      : default_color;
+    if (vector || angle) {
+      flush();
+      cairo_save(cr_);
+      cairo_translate(cr_, x, y);
+      cairo_rotate(cr_, -angle * M_PI / 180);
+      // Shaping depends on the CTM, so must come after the rotation.
+      auto const& layout = shape_text(cr_, s);
+      auto const& gac = layout->gac;
+      warn_on_missing_glyphs(gac, s);
+      auto const& [dx, dy] = anchor_offset(layout->get_extents(cr_));
+      cairo_translate(cr_, dx, dy);
+      cairo_move_to(cr_, 0, 0);
+      auto const& [r, g, b, a] = color;
+      cairo_set_source_rgba(cr_, r, g, b, a);
+      cairo_show_text_glyphs(
+        cr_, s.c_str(), s.size(),
+        gac.glyphs, gac.num_glyphs,
+        gac.clusters, gac.num_clusters, gac.cluster_flags);
+      cairo_restore(cr_);
+    } else {
+      auto const& layout = shape_text(cr_, s);
+      auto const& gac = layout->gac;
+      warn_on_missing_glyphs(gac, s);
+      auto const& [dx, dy] = anchor_offset(layout->get_extents(cr_));
+      if (color != glyphs_color) {
+        flush();
+        glyphs_color = color;
+      }
+      for (auto j = 0; j < gac.num_glyphs; ++j) {
+        auto const& glyph = gac.glyphs[j];
+        glyphs.push_back({glyph.index, x + dx + glyph.x, y + dy + glyph.y});
       }
-      bytes_pos = next_bytes_pos;
-      glyphs_pos = next_glyphs_pos;
     }
-    cairo_show_text_glyphs(
-      cr_, s.c_str(), s.size(),
-      gac.glyphs, gac.num_glyphs,
-      gac.clusters, gac.num_clusters, gac.cluster_flags);
   }
+  flush();
 }
 
 std::tuple<double, double, double>
 GraphicsContextRenderer::get_text_width_height_descent(
   std::string s, py::object prop, py::object ismath)
 {
+  auto const& timed =
+    Timed{stats_, "get_text_width_height_descent", s.size()};
   // - "height" includes "descent", and "descent" is (normally) positive
   // (see MathtextBackendAgg.get_results()).
   // - "ismath" can be True, False, "TeX" (i.e., usetex).
@@ -1477,9 +2525,8 @@ GraphicsContextRenderer::get_text_width_height_descent(
   if (ismath.cast<bool>()) {
     // NOTE: Agg reports nonzero descents for seemingly zero-descent cases.
     return
-      py::module::import("mplcairo")
-      .attr("_mathtext_parse")(s, get_additional_state().dpi, prop)
-      .cast<MathtextBackend>().get_text_width_height_descent();
+      parse_mathtext(s, get_additional_state().dpi, prop)
+      ->get_text_width_height_descent();
   } else {
     cairo_save(cr_);
     auto const& font_face = font_face_from_prop(prop);
@@ -1488,9 +2535,7 @@ GraphicsContextRenderer::get_text_width_height_descent(
     auto const& font_size =
       points_to_pixels(prop.attr("get_size_in_points")().cast<double>());
     cairo_set_font_size(cr_, font_size);
-    cairo_text_extents_t extents;
-    auto const& gac = text_to_glyphs_and_clusters(cr_, s);
-    cairo_glyph_extents(cr_, gac.glyphs, gac.num_glyphs, &extents);
+    auto const& extents = shape_text(cr_, s)->get_extents(cr_);
     cairo_restore(cr_);
     return {
       extents.width + extents.x_bearing,
@@ -1523,6 +2568,17 @@ py::array GraphicsContextRenderer::_stop_filter_get_buffer()
   return buffer;
 }
 
+void GraphicsContextRenderer::clear()
+{
+  cairo_save(cr_);
+  cairo_set_operator(cr_, CAIRO_OPERATOR_CLEAR);
+  cairo_paint(cr_);
+  cairo_restore(cr_);
+  auto const& state = get_additional_state();
+  add_damage(
+    {0, 0, int(std::ceil(state.width)), int(std::ceil(state.height))});
+}
+
 Region GraphicsContextRenderer::copy_from_bbox(py::object bbox)
 {
   auto const& state = get_additional_state();
@@ -1588,16 +2644,68 @@ void GraphicsContextRenderer::restore_region(Region& region)
       region.buffer.get() + (y - y0) * 4 * width, 4 * width);
   }
   cairo_surface_mark_dirty_rectangle(surface, x0, y0, width, height);
+  add_damage(region.bbox);
 }
 
 MathtextBackend::Glyph::Glyph(
   std::string path, double size,
   std::variant<char32_t, std::string, FT_ULong> codepoint_or_name_or_index,
   double x, double y) :
-  path{path}, size{size},
-  codepoint_or_name_or_index{codepoint_or_name_or_index},
-  x{x}, y{y}
-{}
+  font_face{font_face_from_path(path), cairo_font_face_destroy},
+  size{size}, index{}, x{x}, y{y}
+{
+  auto ft_face =
+    static_cast<FT_Face>(
+      cairo_font_face_get_user_data(font_face.get(), &detail::FT_KEY));
+  std::visit(overloaded {
+    [&](char32_t codepoint) {
+      // The last unicode charmap is the FreeType-synthesized one.
+      auto i = ft_face->num_charmaps - 1;
+      for (; i >= 0; --i) {
+        if (ft_face->charmaps[i]->encoding == FT_ENCODING_UNICODE) {
+          FT_CHECK(FT_Set_Charmap, ft_face, ft_face->charmaps[i]);
+          break;
+        }
+      }
+      if (i < 0) {
+        throw std::runtime_error{"no unicode charmap found"};
+      }
+      index = FT_Get_Char_Index(ft_face, codepoint);
+      if (!index) {
+        warn_on_missing_glyph("#" + std::to_string(index));
+      }
+    },
+    [&](std::string name) {
+      index = FT_Get_Name_Index(ft_face, name.data());
+      if (!index) {
+        warn_on_missing_glyph(name);
+      }
+    },
+    [&](FT_ULong idx) {
+      // For the usetex case, look up the "native" font charmap,
+      // which typically has a TT_ENCODING_ADOBE_STANDARD or
+      // TT_ENCODING_ADOBE_CUSTOM encoding, unlike the FreeType-synthesized
+      // one which has a TT_ENCODING_UNICODE encoding.
+      auto found = false;
+      for (auto i = 0; i < ft_face->num_charmaps; ++i) {
+        if (ft_face->charmaps[i]->encoding != FT_ENCODING_UNICODE) {
+          if (found) {
+            throw std::runtime_error{"multiple non-unicode charmaps found"};
+          }
+          FT_CHECK(FT_Set_Charmap, ft_face, ft_face->charmaps[i]);
+          found = true;
+        }
+      }
+      if (!found) {
+        throw std::runtime_error{"no builtin charmap found"};
+      }
+      index = FT_Get_Char_Index(ft_face, idx);
+      if (!index) {
+        warn_on_missing_glyph("#" + std::to_string(index));
+      }
+    }
+  }, codepoint_or_name_or_index);
+}
 
 MathtextBackend::MathtextBackend() :
   glyphs_{},
@@ -1685,66 +2793,12 @@ void MathtextBackend::_draw(
   cairo_rotate(cr, -angle * M_PI / 180);
   cairo_translate(cr, 0, -bearing_y_);
   for (auto const& glyph: glyphs_) {
-    auto const& font_face = font_face_from_path(glyph.path);
-    cairo_set_font_face(cr, font_face);
-    cairo_font_face_destroy(font_face);
+    cairo_set_font_face(cr, glyph.font_face.get());
     cairo_set_font_size(cr, glyph.size * dpi / 72);
     auto const& options = get_font_options();
     cairo_set_font_options(cr, options.get());
-    auto ft_face =
-      static_cast<FT_Face>(
-        cairo_font_face_get_user_data(font_face, &detail::FT_KEY));
-    auto index = FT_UInt{};
-    std::visit(overloaded {
-      [&](char32_t codepoint) {
-        // The last unicode charmap is the FreeType-synthesized one.
-        auto i = ft_face->num_charmaps - 1;
-        for (; i >= 0; --i) {
-          if (ft_face->charmaps[i]->encoding == FT_ENCODING_UNICODE) {
-            FT_CHECK(FT_Set_Charmap, ft_face, ft_face->charmaps[i]);
-            break;
-          }
-        }
-        if (i < 0) {
-          throw std::runtime_error{"no unicode charmap found"};
-        }
-        index = FT_Get_Char_Index(ft_face, codepoint);
-        if (!index) {
-          warn_on_missing_glyph("#" + std::to_string(index));
-        }
-      },
-      [&](std::string name) {
-        index = FT_Get_Name_Index(ft_face, name.data());
-        if (!index) {
-          warn_on_missing_glyph(name);
-        }
-      },
-      [&](FT_ULong idx) {
-        // For the usetex case, look up the "native" font charmap,
-        // which typically has a TT_ENCODING_ADOBE_STANDARD or
-        // TT_ENCODING_ADOBE_CUSTOM encoding, unlike the FreeType-synthesized
-        // one which has a TT_ENCODING_UNICODE encoding.
-        auto found = false;
-        for (auto i = 0; i < ft_face->num_charmaps; ++i) {
-          if (ft_face->charmaps[i]->encoding != FT_ENCODING_UNICODE) {
-            if (found) {
-              throw std::runtime_error{"multiple non-unicode charmaps found"};
-            }
-            FT_CHECK(FT_Set_Charmap, ft_face, ft_face->charmaps[i]);
-            found = true;
-          }
-        }
-        if (!found) {
-          throw std::runtime_error{"no builtin charmap found"};
-        }
-        index = FT_Get_Char_Index(ft_face, idx);
-        if (!index) {
-          warn_on_missing_glyph("#" + std::to_string(index));
-        }
-      }
-    }, glyph.codepoint_or_name_or_index);
-    auto const& raw_glyph = cairo_glyph_t{index, glyph.x, glyph.y};
-    cairo_show_glyphs(cr, &raw_glyph, 1);
+    auto const& raw_glyph = cairo_glyph_t{glyph.index, glyph.x, glyph.y};
+    show_glyphs(cr, &raw_glyph, 1);
   }
   for (auto const& [x, y, w, h]: rectangles_) {
     cairo_rectangle(cr, x, y, w, h);
@@ -1871,12 +2925,30 @@ Get library versions.
         }
         detail::FLOAT_SURFACE = *float_surface;
       }
+      if (auto const& glyph_atlas = pop_option("glyph_atlas", bool{})) {
+        detail::GLYPH_ATLAS = *glyph_atlas;
+      }
+      if (auto const& layout_cache_size =
+            pop_option("layout_cache_size", size_t{})) {
+        detail::LAYOUT_CACHE_SIZE = *layout_cache_size;
+      }
       if (auto const& marker_threads = pop_option("marker_threads", int{})) {
         detail::MARKER_THREADS = *marker_threads;
       }
       if (auto const& miter_limit = pop_option("miter_limit", double{})) {
         detail::MITER_LIMIT = *miter_limit;
       }
+      if (auto const& path_decimation =
+            pop_option("path_decimation", bool{})) {
+        detail::PATH_DECIMATION = *path_decimation;
+      }
+      if (auto const& pattern_cache_bytes =
+            pop_option("pattern_cache_bytes", size_t{})) {
+        detail::PATTERN_CACHE_BYTES = *pattern_cache_bytes;
+      }
+      if (auto const& profile = pop_option("profile", bool{})) {
+        detail::PROFILE = *profile;
+      }
       if (auto const& raqm = pop_option("raqm", bool{})) {
         if (*raqm) {
           load_raqm();
@@ -1884,6 +2956,14 @@ Get library versions.
           unload_raqm();
         }
       }
+      if (auto const& release_gil = pop_option("release_gil", bool{})) {
+        detail::RELEASE_GIL = *release_gil;
+      }
+      if (auto const& surface_pool_bytes =
+            pop_option("surface_pool_bytes", size_t{})) {
+        detail::SURFACE_POOL_BYTES = *surface_pool_bytes;
+        trim_surface_pool();
+      }
       if (py::bool_(kwargs)) {
         throw std::runtime_error{
           "unknown options passed to set_options: {}"_format(kwargs)
@@ -1902,8 +2982,23 @@ float_surface : bool, default: False
   Whether to use a floating point surface (more accurate, but uses more
   memory).
 
+glyph_atlas : bool, default: False
+  Whether to draw unrotated text on raster outputs by compositing glyphs which
+  are rasterized only once (per font, size, and quarter-pixel position) and
+  cached process-wide, rather than rasterizing each glyph on each draw.  This
+  speeds up text-heavy figures, but subpixel antialiasing (the default, per
+  :rc:`text.antialiased`) is replaced by grayscale antialiasing.
+
+layout_cache_size : int, default: 4096
+  Number of shaped texts (glyphs and their extents), and separately of parsed
+  mathtext strings, cached process-wide, so that repeated strings (e.g. tick
+  labels, drawn and measured many times) are only shaped or parsed once.
+  Texts still get reshaped if any font setting changes.
+
 marker_threads : int, default: 0
-  Number of threads to use to render markers, if nonzero.
+  Number of threads to use to render markers, stamped collections (e.g.
+  scatter plots), colormapped images and, on raster outputs, quad meshes (e.g.
+  pcolormesh without edges), if nonzero.
 
 miter_limit : float, default: 10
   Setting for cairo_set_miter_limit__.  If negative, use Matplotlib's (bad)
@@ -1911,8 +3006,45 @@ miter_limit : float, default: 10
 
   __ https://www.cairographics.org/manual/cairo-cairo-t.html#cairo-set-miter-limit
 
+path_decimation : bool, default: False
+  Whether to decimate long lines without path codes (e.g. dense line plots)
+  before stroking them on raster outputs: each run of consecutive vertices
+  within the same pixel column is reduced to its first, lowest, highest and
+  last vertices, which outline (up to antialiasing) the same stroke.  Dashed
+  and sketched lines are not decimated.
+
+pattern_cache_bytes : int, default: 64 MiB
+  Memory budget, per renderer, of the stamps cached to draw path collections
+  (e.g. scatter plots) across draws; the least recently used stamps are evicted
+  first.  If zero, stamps are only reused within a single draw call.
+
+profile : bool, default: False
+  Whether renderers collect per-operation statistics, which can be retrieved
+  (and optionally reset) with ``renderer._get_stats(reset=False)``.  This
+  returns a dict mapping each instrumented operation (``draw_*`` methods;
+  helpers calling back into Python, such as ``to_rgba`` (on color cache
+  misses), ``to_rgba_array``, ``load_path_exact`` or
+  ``text_to_glyphs_and_clusters``; cairo-bound steps, such as
+  ``fill_and_stroke_exact`` or ``cairo_mask``; and stamp cache hits, misses,
+  culled stamps and recycled stamp surfaces,
+  ``pattern_cache.{hit,miss,culled,recycled}``) to its number of
+  ``calls``, of processed ``items`` (vertices, paths, pixels, characters, or
+  stamp bytes) and its inclusive time in ``seconds``.
+
 raqm : bool, default: if available
   Whether to use Raqm for text rendering.
+
+release_gil : bool, default: False
+  Whether to release the GIL while cairo rasterizes paths, markers, meshes and
+  images.  Figures are then drawn under a per-canvas lock instead of a global
+  one (text rendering remains serialized), so that independent figures can be
+  drawn in parallel from multiple threads.
+
+surface_pool_bytes : int, default: 64 MiB
+  Memory budget of the process-wide pool of image surfaces released by
+  renderers (once nothing else references them), from which new renderers of
+  the same size are allocated, e.g. when repeatedly saving figures of a few
+  standard sizes to raster formats.  If zero, surfaces are not pooled.
 )__doc__");
   m.def(
     "get_options",
@@ -1920,14 +3052,49 @@ raqm : bool, default: if available
       return py::dict(
         "cairo_circles"_a=!detail::UNIT_CIRCLE.is_none(),
         "float_surface"_a=detail::FLOAT_SURFACE,
+        "glyph_atlas"_a=detail::GLYPH_ATLAS,
+        "layout_cache_size"_a=detail::LAYOUT_CACHE_SIZE,
         "marker_threads"_a=detail::MARKER_THREADS,
         "miter_limit"_a=detail::MITER_LIMIT,
-        "raqm"_a=has_raqm());
+        "path_decimation"_a=detail::PATH_DECIMATION,
+        "pattern_cache_bytes"_a=detail::PATTERN_CACHE_BYTES,
+        "profile"_a=detail::PROFILE,
+        "raqm"_a=has_raqm(),
+        "release_gil"_a=detail::RELEASE_GIL,
+        "surface_pool_bytes"_a=detail::SURFACE_POOL_BYTES);
     }, R"__doc__(
 Get current mplcairo options.  See `set_options` for a description of available
 options.
 )__doc__");
 
+  // Buffer conversions (see _util.py).
+  for (auto const& [name, target, desc]: {
+         std::tuple{
+           "cairo_to_premultiplied_argb32", PixelFormat::PremultipliedARGB32,
+           "premultiplied ARGB32"},
+         std::tuple{
+           "cairo_to_premultiplied_rgba8888",
+           PixelFormat::PremultipliedRGBA8888, "premultiplied RGBA8888"},
+         std::tuple{
+           "cairo_to_straight_rgba8888", PixelFormat::StraightRGBA8888,
+           "straight RGBA8888"}}) {
+    m.def(
+      name,
+      [target=target](
+        py::array buf, std::optional<py::array_t<uint8_t>> out,
+        int n_threads) -> py::array_t<uint8_t> {
+        return convert_cairo_buffer(buf, target, out, n_threads);
+      },
+      "buf"_a, "out"_a=nullptr, "n_threads"_a=0,
+      R"__doc__(
+Convert a buffer from cairo's ARGB32 (premultiplied) or RGBA128F to {}.
+
+The result is written to *out* (which must be a (m, n, 4) uint8 array with
+contiguous pixels, and may be *buf* itself) if given, and returned.  The
+conversion is split over *n_threads* threads, if nonzero.
+)__doc__"_format(desc).cast<std::string>().c_str());
+  }
+
   // Export classes.
 
   // Exposed only for patching Agg (but internally used for copy_from_bbox /
@@ -1943,6 +3110,8 @@ options.
         return r.get_st_argb32_bytes();
       });
 
+  py::class_<Layer>(m, "_Layer");
+
   py::class_<GraphicsContextRenderer>(m, "GraphicsContextRendererCairo")
     // The RendererAgg signature, which is also expected by MixedModeRenderer
     // (with doubles!).
@@ -1980,7 +3149,20 @@ options.
     .def("_set_metadata", &GraphicsContextRenderer::_set_metadata)
     .def("_set_size", &GraphicsContextRenderer::_set_size)
     .def("_show_page", &GraphicsContextRenderer::_show_page)
+    .def("_replay_page", &GraphicsContextRenderer::_replay_page)
     .def("_get_buffer", &GraphicsContextRenderer::_get_buffer)
+    .def("_get_stats", &GraphicsContextRenderer::_get_stats,
+         "reset"_a=false)
+    .def("_get_damage", &GraphicsContextRenderer::_get_damage,
+         "reset"_a=false)
+    .def("_get_damaged_buffers",
+         &GraphicsContextRenderer::_get_damaged_buffers,
+         "format"_a, "rects"_a=nullptr)
+    .def("_snapshot_layer", &GraphicsContextRenderer::_snapshot_layer)
+    .def("_restore_layer", &GraphicsContextRenderer::_restore_layer)
+    .def("_write_png", &GraphicsContextRenderer::_write_png,
+         "file"_a, "metadata"_a, "dpi"_a,
+         "compress_level"_a=6, "filter"_a="adaptive")
     .def("_finish", &GraphicsContextRenderer::_finish)
 
     // GraphicsContext API.
@@ -2105,6 +3287,11 @@ options.
     .def("draw_gouraud_triangles",
          &GraphicsContextRenderer::draw_gouraud_triangles)
     .def("draw_image", &GraphicsContextRenderer::draw_image)
+    .def("_draw_cairo_buffer", &GraphicsContextRenderer::_draw_cairo_buffer)
+    .def("draw_colormapped_image",
+         &GraphicsContextRenderer::draw_colormapped_image,
+         "gc"_a, "data"_a, "lut"_a, "vmin"_a, "vmax"_a, "transform"_a,
+         "interpolation"_a="nearest")
     .def("draw_markers", &GraphicsContextRenderer::draw_markers,
          "gc"_a, "marker_path"_a, "marker_trans"_a, "path"_a, "trans"_a,
          "rgbFace"_a=nullptr)
@@ -2116,6 +3303,10 @@ options.
     .def("draw_text", &GraphicsContextRenderer::draw_text,
          "gc"_a, "x"_a, "y"_a, "s"_a, "prop"_a, "angle"_a,
          "ismath"_a=false, "mtext"_a=nullptr)
+    .def("draw_texts", &GraphicsContextRenderer::draw_texts,
+         "gc"_a, "offsets"_a, "texts"_a, "prop"_a,
+         "angles"_a=py::none(), "colors"_a=py::none(),
+         "ha"_a="left", "va"_a="baseline")
     .def("get_text_width_height_descent",
          &GraphicsContextRenderer::get_text_width_height_descent,
          "s"_a, "prop"_a, "ismath"_a)
@@ -2125,15 +3316,7 @@ options.
          &GraphicsContextRenderer::_stop_filter_get_buffer)
 
     // FIXME[matplotlib]: Needed for webagg_core, although we also use it.
-    .def(
-      "clear",
-      [](GraphicsContextRenderer& gcr) -> void {
-        auto const& cr = gcr.cr_;
-        cairo_save(cr);
-        cairo_set_operator(cr, CAIRO_OPERATOR_CLEAR);
-        cairo_paint(cr);
-        cairo_restore(cr);
-      })
+    .def("clear", &GraphicsContextRenderer::clear)
 
     // Canvas API.
     .def("copy_from_bbox", &GraphicsContextRenderer::copy_from_bbox)
@@ -6,8 +6,13 @@ namespace mplcairo {
 
 namespace py = pybind11;
 
+class PatternCache;
+
 enum class StreamSurfaceType {
-  PDF, PS, EPS, SVG, Script
+  PDF, PS, EPS, SVG, Script,
+  // Not a stream surface: records drawing commands, for later replay onto
+  // another renderer with _replay_page.
+  Recording
 };
 
 struct Region {
@@ -19,12 +24,48 @@ struct Region {
   py::bytes get_st_argb32_bytes();
 };
 
+// A snapshot of a renderer's canvas (e.g., the static background of an
+// animation), see GraphicsContextRenderer::_snapshot_layer.
+struct Layer {
+  std::shared_ptr<cairo_surface_t> surface;
+};
+
 class GraphicsContextRenderer {
   public:
   cairo_t* const cr_;
 
   private:
   std::optional<std::string> path_ = {};
+  // Stamps used by draw_path_collection, persisted across draws.
+  std::shared_ptr<PatternCache> pattern_cache_ = {};
+  double pattern_cache_dpi_ = {};
+  // Filled while the profile option is set.
+  Stats stats_ = {};
+  // The last clip path loaded by set_clip_path, reused if the next one is
+  // identical (typically, all artists of an axes are clipped to its patch).
+  struct ClipPathCache {
+    std::vector<double> vertices;
+    std::optional<std::vector<uint8_t>> codes;
+    cairo_matrix_t matrix, ctm;
+    bool snap;
+    double line_width;
+    std::shared_ptr<cairo_path_t> path;
+  };
+  std::optional<ClipPathCache> clip_path_cache_ = {};
+  // Repeating hatch patterns (null if there is no hatch path), by hatch,
+  // hatch color, hatch linewidth and dpi; they are created similar to (and
+  // cached together with) the target surface, whose type is thus fixed.
+  std::map<
+    std::tuple<std::string, rgba_t, double, int>,
+    std::shared_ptr<cairo_pattern_t>> hatch_patterns_ = {};
+  // On image surfaces, the device-space regions drawn over since the last
+  // _get_damage(reset=True), and since the last layer snapshot or restore;
+  // and the layer whose contents match the canvas outside of layer_damage_.
+  std::shared_ptr<cairo_region_t> damage_ = {}, layer_damage_ = {};
+  std::weak_ptr<cairo_surface_t> layer_ = {};
+  // Whether the current draw call recorded its damage more tightly than the
+  // extents of its clip (see AdditionalContext).
+  bool damage_recorded_ = false;
 
   private:
 
@@ -42,6 +83,11 @@ class GraphicsContextRenderer {
 
   double pixels_to_points(double pixels);
   rgba_t get_rgba();
+  void write_svg_image(cairo_surface_t* surface);
+  PatternCache& get_pattern_cache(double threshold);
+  cairo_pattern_t* get_hatch_pattern();
+  void add_damage(double x0, double y0, double x1, double y1);
+  void add_damage(cairo_rectangle_int_t const& rect);
 
   public:
 
@@ -68,7 +114,18 @@ class GraphicsContextRenderer {
   void _set_metadata(std::optional<py::dict> metadata);
   void _set_size(double width, double height, double dpi);
   void _show_page();
+  void _replay_page(GraphicsContextRenderer& page);
   py::array _get_buffer();
+  py::dict _get_stats(bool reset);
+  std::vector<std::tuple<int, int, int, int>> _get_damage(bool reset);
+  std::vector<std::tuple<int, int, py::array_t<uint8_t>>> _get_damaged_buffers(
+    std::string format,
+    std::optional<std::vector<std::tuple<int, int, int, int>>> rects);
+  Layer _snapshot_layer();
+  void _restore_layer(Layer const& layer);
+  void _write_png(
+    py::object file, py::dict metadata, std::tuple<double, double> dpi,
+    int compress_level, std::string filter);
   void _finish();
 
   void set_alpha(std::optional<double> alpha);
@@ -106,6 +163,12 @@ class GraphicsContextRenderer {
   void draw_image(
     GraphicsContextRenderer& gc,
     double x, double y, py::array_t<uint8_t> im);
+  void _draw_cairo_buffer(
+    GraphicsContextRenderer& gc, double x, double y, py::array buf);
+  void draw_colormapped_image(
+    GraphicsContextRenderer& gc,
+    py::array data, py::array_t<uint8_t> lut, double vmin, double vmax,
+    py::object transform, std::string interpolation);
   void draw_markers(
     GraphicsContextRenderer& gc,
     py::object marker_path,
@@ -147,23 +210,34 @@ class GraphicsContextRenderer {
     GraphicsContextRenderer& gc,
     double x, double y, std::string s, py::object prop, double angle,
     bool ismath, py::object mtext);
+  void draw_texts(
+    GraphicsContextRenderer& gc,
+    py::array_t<double> offsets,
+    std::vector<std::string> texts,
+    py::object prop,
+    std::optional<py::array_t<double>> angles,
+    std::optional<py::array_t<double>> colors,
+    std::string ha, std::string va);
   std::tuple<double, double, double> get_text_width_height_descent(
     std::string s, py::object prop, py::object ismath);
 
   void start_filter();
   py::array _stop_filter_get_buffer();
 
+  void clear();
   Region copy_from_bbox(py::object bbox);
   void restore_region(Region& region);
 };
 
 class MathtextBackend {
+  // Glyphs are resolved (to a font face and a glyph index) when the mathtext
+  // is parsed, so that drawing a cached parse does no lookups.
   struct Glyph {
     // NOTE: It may be more efficient to hold onto an array of FT_Glyphs but
     // that will wait for the ft2 rewrite in Matplotlib itself.
-    std::string path;
+    std::shared_ptr<cairo_font_face_t> font_face;
     double size;
-    std::variant<char32_t, std::string, FT_ULong> codepoint_or_name_or_index;
+    FT_UInt index;
     double x, y;
 
     Glyph(
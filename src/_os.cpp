@@ -2,7 +2,9 @@
 
 #if defined __linux__ || defined __APPLE__
 #include <dlfcn.h>
+#include <unistd.h>
 #elif defined _WIN32
+#include <io.h>
 #include <memory>
 
 #define NOMINMAX
@@ -10,6 +12,10 @@
 #include <Windows.h>
 #endif
 
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+
 #include <pybind11/pybind11.h>
 
 namespace mplcairo::os {
@@ -37,6 +43,21 @@ void throw_dlerror() {
   throw py::error_already_set{};
 }
 
+bool write(int fd, char const* data, size_t size) {
+  while (size) {
+    auto const& n = ::write(fd, data, size);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
 #elif defined _WIN32
 using library_t = HMODULE;
 using symbol_t = FARPROC;
@@ -74,6 +95,22 @@ void throw_dlerror() {
   throw py::error_already_set{};
 }
 
+bool write(int fd, char const* data, size_t size) {
+  while (size) {
+    auto const& n =
+      ::_write(fd, data, unsigned(std::min<size_t>(size, INT_MAX)));
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    data += n;
+    size -= n;
+  }
+  return true;
+}
+
 #endif
 
 }
@@ -21,5 +21,8 @@ library_t dlopen(char const* filename);
 bool dlclose(library_t handle);
 symbol_t dlsym(library_t handle, char const* symbol);
 void throw_dlerror();
+// Writes the whole buffer to a file descriptor, retrying on partial writes;
+// returns false (with errno set) on failure.
+bool write(int fd, char const* data, size_t size);
 
 }
@@ -4,19 +4,23 @@
 
 #include "_macros.h"
 
+#include <cstring>
+#include <string_view>
+
 namespace mplcairo {
 
 dash_t convert_dash(cairo_t* cr)
 {
-  auto const& dash_count = cairo_get_dash_count(cr);
-  auto const& dashes = std::unique_ptr<double[]>{new double[dash_count]};
+  // Reuse a per-thread buffer across calls (dash lists are short).
+  thread_local auto dashes = std::vector<double>{};
+  dashes.resize(cairo_get_dash_count(cr));
   double offset;
-  cairo_get_dash(cr, dashes.get(), &offset);
+  cairo_get_dash(cr, dashes.data(), &offset);
   return {
     offset,
     std::string{
-      reinterpret_cast<char*>(dashes.get()),
-      dash_count * sizeof(dashes[0])}};
+      reinterpret_cast<char*>(dashes.data()),
+      dashes.size() * sizeof(dashes[0])}};
 }
 
 void set_dashes(cairo_t* cr, dash_t dash)
@@ -29,6 +33,29 @@ void set_dashes(cairo_t* cr, dash_t dash)
     offset);
 }
 
+// Hash of the contents (vertices and codes) of a Matplotlib Path.
+size_t hash_path_contents(py::object path)
+{
+  auto const& hash_array = [](py::array array) -> size_t {
+    return std::hash<std::string_view>{}(
+      {static_cast<char const*>(array.data()),
+       size_t(array.nbytes())});
+  };
+  auto const& vertices =
+    path.attr("vertices")
+    .cast<py::array_t<double, py::array::c_style | py::array::forcecast>>();
+  auto const& codes =
+    path.attr("codes")
+    .cast<std::optional<
+      py::array_t<uint8_t, py::array::c_style | py::array::forcecast>>>();
+  auto const& vertices_hash = hash_array(vertices),
+            & codes_hash = codes ? hash_array(*codes) : 0;
+  // boost::hash_combine, as in Hash::operator().
+  return
+    vertices_hash ^ (codes_hash + 0x9e3779b9 + (vertices_hash << 6)
+                     + (vertices_hash >> 2));
+}
+
 void PatternCache::CacheKey::draw(
   cairo_t* cr, double x, double y, rgba_t color)
 {
@@ -64,6 +91,7 @@ size_t PatternCache::Hash::operator()(CacheKey const& key) const
   // std::tuple is not hashable by default.  Reuse boost::hash_combine.
   size_t hashes[] = {
     std::hash<void*>{}(key.path.ptr()),
+    key.path_hash,
     std::hash<double>{}(key.matrix.xx), std::hash<double>{}(key.matrix.xy),
     std::hash<double>{}(key.matrix.yx), std::hash<double>{}(key.matrix.yy),
     std::hash<double>{}(key.matrix.x0), std::hash<double>{}(key.matrix.y0),
@@ -84,7 +112,7 @@ bool PatternCache::EqualTo::operator()(
   CacheKey const& lhs, CacheKey const& rhs) const
 {
   return
-    lhs.path.is(rhs.path)
+    lhs.path.is(rhs.path) && lhs.path_hash == rhs.path_hash
     && lhs.matrix.xx == rhs.matrix.xx && lhs.matrix.xy == rhs.matrix.xy
     && lhs.matrix.yx == rhs.matrix.yx && lhs.matrix.yy == rhs.matrix.yy
     && lhs.matrix.x0 == rhs.matrix.x0 && lhs.matrix.y0 == rhs.matrix.y0
@@ -93,7 +121,8 @@ bool PatternCache::EqualTo::operator()(
     && lhs.capstyle == rhs.capstyle && lhs.joinstyle == rhs.joinstyle;
 }
 
-PatternCache::PatternCache(double threshold) : threshold_{threshold}
+PatternCache::PatternCache(double threshold) :
+  threshold_{threshold}, bytes_{0}, free_bytes_{0}
 {
   if (threshold >= 1. / 16) {  // NOTE: Arbitrary limit.
     n_subpix_ = std::ceil(1 / threshold);
@@ -110,69 +139,148 @@ PatternCache::~PatternCache()
       cairo_pattern_destroy(entry.patterns[i]);
     }
   }
+  for (auto const& [size, surface]: free_surfaces_) {
+    (void)size;
+    cairo_surface_destroy(surface);
+  }
 }
 
-void PatternCache::mask(
+double PatternCache::threshold() const
+{
+  return threshold_;
+}
+
+// Evict the least recently used patterns until at most `max_bytes` are used.
+// This must only be called once the patterns returned by get_stamp are not
+// needed anymore, i.e. at the end of a draw call.
+void PatternCache::trim(size_t max_bytes)
+{
+  while (bytes_ > max_bytes) {
+    auto const& it = patterns_.find(*lru_.back());
+    auto const& entry = it->second;
+    for (size_t i = 0; i < n_subpix_ * n_subpix_; ++i) {
+      recycle(entry.patterns[i]);
+    }
+    bytes_ -= entry.bytes;
+    lru_.pop_back();
+    patterns_.erase(it);
+  }
+  // The path bboxes are cheap to recompute, and must be recomputed anyways if
+  // the paths get mutated.
+  paths_.clear();
+}
+
+// Destroy `pattern` (which may be null), keeping its stamp surface for reuse
+// by take_surface if nothing else references it, within SCRATCH_BYTES.
+void PatternCache::recycle(cairo_pattern_t* pattern)
+{
+  cairo_surface_t* surface;
+  if (pattern
+      && cairo_pattern_get_surface(pattern, &surface) == CAIRO_STATUS_SUCCESS
+      && cairo_surface_get_reference_count(surface) == 1) {
+    auto const& width = cairo_image_surface_get_width(surface),
+              & height = cairo_image_surface_get_height(surface);
+    auto const& bytes =
+      size_t(cairo_image_surface_get_stride(surface)) * height;
+    if (free_bytes_ + bytes <= SCRATCH_BYTES) {
+      free_surfaces_.emplace(
+        size_t(width) << 32 | size_t(height),
+        cairo_surface_reference(surface));
+      free_bytes_ += bytes;
+    }
+  }
+  cairo_pattern_destroy(pattern);
+}
+
+// Return a cleared A8 surface of the given size, recycled if possible.
+cairo_surface_t* PatternCache::take_surface(int width, int height)
+{
+  auto const& it = free_surfaces_.find(size_t(width) << 32 | size_t(height));
+  if (it == free_surfaces_.end()) {
+    return cairo_image_surface_create(CAIRO_FORMAT_A8, width, height);
+  }
+  auto const& surface = it->second;
+  free_surfaces_.erase(it);
+  auto const& bytes = size_t(cairo_image_surface_get_stride(surface)) * height;
+  free_bytes_ -= bytes;
+  cairo_surface_flush(surface);
+  std::memset(cairo_image_surface_get_data(surface), 0, bytes);
+  cairo_surface_mark_dirty(surface);
+  record_stat("pattern_cache.recycled");
+  return surface;
+}
+
+PatternCache::CacheKey PatternCache::make_key(
   cairo_t* cr,
   py::object path,
   cairo_matrix_t matrix,
   draw_func_t draw_func,
   double linewidth,
-  dash_t dash,
-  double x, double y)
+  dash_t dash)
 {
-  // The matrix gets cached, so we may as well take it by value instead of by
-  // pointer.
-  auto key =
+  return
     draw_func == draw_func_t::Fill
     ? CacheKey{
-      path, matrix, draw_func, 0, {},
+      path, 0, matrix, draw_func, 0, {},
       static_cast<cairo_line_cap_t>(-1), static_cast<cairo_line_join_t>(-1)}
     : CacheKey{
-      path, matrix, draw_func, linewidth, dash,
+      path, 0, matrix, draw_func, linewidth, dash,
       cairo_get_line_cap(cr), cairo_get_line_join(cr)};
-  auto const& draw_direct = [&]() -> void {
-    double r, g, b, a;
-    CAIRO_CHECK(cairo_pattern_get_rgba, cairo_get_source(cr), &r, &g, &b, &a);
-    key.draw(cr, x, y, {r, g, b, a});
-  };
+}
+
+// Return the stamp to use to draw `path`, rasterizing it if needed, or nullopt
+// if the path should instead be drawn directly (see draw_direct).
+std::optional<PatternCache::Stamp> PatternCache::get_stamp(
+  cairo_t* cr,
+  Bounds const& bounds,
+  py::object path,
+  cairo_matrix_t matrix,
+  draw_func_t draw_func,
+  double linewidth,
+  dash_t dash,
+  double x, double y)
+{
   if (!n_subpix_) {
-    draw_direct();
-    return;
+    return {};
   }
+  // The matrix gets cached, so we may as well take it by value instead of by
+  // pointer.
+  auto key = make_key(cr, path, matrix, draw_func, linewidth, dash);
   // Get the untransformed path bbox with cairo_path_extents(), so that we
   // know how to quantize the transformation matrix.  Note that this ignores
   // the additional size from linewidths, including miters (they will only
   // contribute a constant offset).
   // Importantly, cairo_*_extents() ignores surface dimensions and clipping.
-  auto it_bboxes = bboxes_.find(key.path);
-  if (it_bboxes == bboxes_.end()) {
+  auto it_paths = paths_.find(key.path);
+  if (it_paths == paths_.end()) {
     auto const& id = cairo_matrix_t{1, 0, 0, 1, 0, 0};
     load_path_exact(cr, key.path, &id);
     double x0, y0, x1, y1;
     cairo_path_extents(cr, &x0, &y0, &x1, &y1);
     bool ok;
-    std::tie(it_bboxes, ok) =
-      bboxes_.emplace(key.path, cairo_rectangle_t{x0, y0, x1 - x0, y1 - y0});
+    std::tie(it_paths, ok) =
+      paths_.emplace(
+        key.path,
+        PathEntry{
+          cairo_rectangle_t{x0, y0, x1 - x0, y1 - y0},
+          hash_path_contents(key.path)});
     if (!ok) {
       throw std::runtime_error{"unexpected insertion failure into cache"};
     }
   }
+  key.path_hash = it_paths->second.hash;
   // Approximate ("quantize") the transform matrix, so that the transformed
   // path is within 3x(threshold/3) of the path transformed by the original
   // matrix.  1x threshold will be added by the patterns_ cache.
   // If the entire object is within the threshold of the origin in either
   // direction, then draw it directly, as doing otherwise would be highly
   // inaccurate (see e.g. :mpltest:`test_mplot3d.test_quiver3d`).
-  auto const& bbox = it_bboxes->second;
+  auto const& bbox = it_paths->second.bbox;
   // Binding by reference results in dangling reference.
   auto const x_max = std::max(std::abs(bbox.x), std::abs(bbox.x + bbox.width)),
              y_max = std::max(std::abs(bbox.y), std::abs(bbox.y + bbox.height));
   if (x_max < threshold_ || y_max < threshold_) {
-    double r, g, b, a;
-    CAIRO_CHECK(cairo_pattern_get_rgba, cairo_get_source(cr), &r, &g, &b, &a);
-    key.draw(cr, x, y, {r, g, b, a});
-    return;
+    return {};
   }
   auto const& eps = threshold_ / 3,
             & x_q = eps / x_max, y_q = eps / y_max,
@@ -206,20 +314,27 @@ void PatternCache::mask(
     // If the pattern is huge, caching it can blow up the memory.
     if (x1 - x0 > get_additional_state(cr).width
         || y1 - y0 > get_additional_state(cr).height) {
-      draw_direct();
-      return;
+      return {};
     }
     auto patterns = std::unique_ptr<cairo_pattern_t*[]>{
       new cairo_pattern_t*[n_subpix_ * n_subpix_]()};  // () for nullptr-init!
+    auto const& bytes = n_subpix_ * n_subpix_ * sizeof(cairo_pattern_t*);
     bool ok;
     std::tie(it_patterns, ok) =
       patterns_.emplace(
-        key, PatternEntry{x0, y0, x1 - x0, y1 - y0, std::move(patterns)});
+        key,
+        PatternEntry{
+          x0, y0, x1 - x0, y1 - y0, std::move(patterns), bytes, {}});
     if (!ok) {
       throw std::runtime_error{"unexpected insertion failure into cache"};
     }
+    bytes_ += bytes;
+    it_patterns->second.lru_it =
+      lru_.insert(lru_.begin(), &it_patterns->first);
+  } else {
+    lru_.splice(lru_.begin(), lru_, it_patterns->second.lru_it);
   }
-  auto const& entry = it_patterns->second;
+  auto& entry = it_patterns->second;
   auto const& target_x = x + entry.x,
             & target_y = y + entry.y;
   auto const& i_target_x = std::floor(target_x),
@@ -229,12 +344,20 @@ void PatternCache::mask(
   auto const& i = int(n_subpix_ * f_target_x),
             & j = int(n_subpix_ * f_target_y);
   auto const& idx = i * n_subpix_ + j;
+  auto const& width = std::ceil(entry.width + 1),
+            & height = std::ceil(entry.height + 1);
+  // Cull stamps entirely outside of the clip before rasterizing them.
+  if (!bounds.intersects(
+        i_target_x, i_target_y, i_target_x + width, i_target_y + height)) {
+    record_stat("pattern_cache.culled");
+    return Stamp{nullptr, i_target_x, i_target_y};
+  }
   auto& pattern = entry.patterns[idx];
-  if (!pattern) {
-    auto const& width = std::ceil(entry.width + 1),
-              & height = std::ceil(entry.height + 1);
-    auto const& raster_surface =
-      cairo_image_surface_create(CAIRO_FORMAT_A8, width, height);
+  if (pattern) {
+    record_stat("pattern_cache.hit");
+  } else {
+    auto timed = Timed{"pattern_cache.miss"};
+    auto const& raster_surface = take_surface(int(width), int(height));
     auto const& raster_gcr =
       GraphicsContextRenderer::make_pattern_gcr(raster_surface);
     key.draw(
@@ -242,12 +365,57 @@ void PatternCache::mask(
       -entry.x + double(i) / n_subpix_, -entry.y + double(j) / n_subpix_);
     pattern = cairo_pattern_create_for_surface(raster_surface);
     cairo_pattern_set_filter(pattern, CAIRO_FILTER_NEAREST);
+    auto const& bytes =
+      size_t(cairo_image_surface_get_stride(raster_surface)) * height;
+    entry.bytes += bytes;
+    bytes_ += bytes;
+    timed.add_items(bytes);
+  }
+  return Stamp{pattern, i_target_x, i_target_y};
+}
+
+// Draw `path` directly (without stamping), using the current source color.
+void PatternCache::draw_direct(
+  cairo_t* cr,
+  py::object path,
+  cairo_matrix_t matrix,
+  draw_func_t draw_func,
+  double linewidth,
+  dash_t dash,
+  double x, double y)
+{
+  double r, g, b, a;
+  CAIRO_CHECK(cairo_pattern_get_rgba, cairo_get_source(cr), &r, &g, &b, &a);
+  make_key(cr, path, matrix, draw_func, linewidth, dash)
+    .draw(cr, x, y, {r, g, b, a});
+}
+
+void PatternCache::mask(
+  cairo_t* cr,
+  Bounds const& bounds,
+  py::object path,
+  cairo_matrix_t matrix,
+  draw_func_t draw_func,
+  double linewidth,
+  dash_t dash,
+  double x, double y)
+{
+  auto const& stamp =
+    get_stamp(cr, bounds, path, matrix, draw_func, linewidth, dash, x, y);
+  if (!stamp) {
+    draw_direct(cr, path, matrix, draw_func, linewidth, dash, x, y);
+    return;
+  }
+  if (!stamp->pattern) {
+    return;
   }
   // Draw using the pattern.
   auto const& pattern_matrix =
-    cairo_matrix_t{1, 0, 0, 1, -i_target_x, -i_target_y};
-  cairo_pattern_set_matrix(pattern, &pattern_matrix);
-  cairo_mask(cr, pattern);
+    cairo_matrix_t{1, 0, 0, 1, -stamp->x, -stamp->y};
+  cairo_pattern_set_matrix(stamp->pattern, &pattern_matrix);
+  auto const& timed = Timed{"cairo_mask"};
+  auto const& nogil = ReleaseGIL{};
+  cairo_mask(cr, stamp->pattern);
 }
 
 }
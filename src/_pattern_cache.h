@@ -2,6 +2,8 @@
 
 #include "_util.h"
 
+#include <list>
+
 namespace mplcairo {
 
 namespace py = pybind11;
@@ -18,6 +20,9 @@ enum class draw_func_t {
 class PatternCache {
   struct CacheKey {
     py::object path;
+    // The cache keeps the paths alive, so their identity is a valid key, but
+    // they may still be mutated in place; hence also key on their contents.
+    size_t path_hash;
     cairo_matrix_t matrix;
     draw_func_t draw_func;
     double linewidth;
@@ -35,26 +40,70 @@ class PatternCache {
     bool operator()(CacheKey const& lhs, CacheKey const& rhs) const;
   };
 
+  struct PathEntry {
+    // Bounds of the non-transformed path.
+    cairo_rectangle_t bbox;
+    size_t hash;
+  };
   struct PatternEntry {
     // Bounds of the transformed path.
     double x, y, width, height;
     std::unique_ptr<cairo_pattern_t*[]> patterns;
+    // Memory used by the entry, and position in the LRU list.
+    size_t bytes;
+    std::list<CacheKey const*>::iterator lru_it;
   };
 
   double threshold_;
   size_t n_subpix_;
-  // Bounds of the non-transformed path.
-  std::unordered_map<py::object, cairo_rectangle_t, Hash> bboxes_;
+  // Only valid during a single draw call (see trim).
+  std::unordered_map<py::object, PathEntry, Hash> paths_;
   // Bounds of the transformed path, and patterns.
   std::unordered_map<CacheKey, PatternEntry, Hash, EqualTo> patterns_;
+  // Keys of patterns_ (whose addresses are stable), most recently used first.
+  std::list<CacheKey const*> lru_;
+  size_t bytes_;
+  // Stamp surfaces of evicted patterns, by size, to be recycled on misses
+  // instead of being reallocated (see trim, get_stamp).
+  std::unordered_multimap<size_t, cairo_surface_t*> free_surfaces_;
+  size_t free_bytes_;
+
+  cairo_surface_t* take_surface(int width, int height);
+  void recycle(cairo_pattern_t* pattern);
+
+  CacheKey make_key(
+    cairo_t* cr, py::object path, cairo_matrix_t matrix,
+    draw_func_t draw_func, double linewidth, dash_t dash);
 
   public:
+  // A stamp (owned by the cache), to be masked with its origin at the integer
+  // position (x, y) of the target.  The pattern is null if the stamp would be
+  // entirely outside of `bounds` (normally the result of get_cull_bounds,
+  // computed once per draw call by the caller), i.e. nothing needs to be
+  // drawn.
+  struct Stamp {
+    cairo_pattern_t* pattern;
+    double x, y;
+  };
+
   PatternCache(double threshold);
   ~PatternCache();
-  void mask(
+  PatternCache(PatternCache const& other) = delete;
+  PatternCache& operator=(PatternCache const& other) = delete;
+  double threshold() const;
+  void trim(size_t max_bytes);
+  std::optional<Stamp> get_stamp(
+    cairo_t* cr, Bounds const& bounds, py::object path, cairo_matrix_t matrix,
+    draw_func_t draw_func, double linewidth, dash_t dash,
+    double x, double y);
+  void draw_direct(
     cairo_t* cr, py::object path, cairo_matrix_t matrix,
     draw_func_t draw_func, double linewidth, dash_t dash,
     double x, double y);
+  void mask(
+    cairo_t* cr, Bounds const& bounds, py::object path, cairo_matrix_t matrix,
+    draw_func_t draw_func, double linewidth, dash_t dash,
+    double x, double y);
 };
 
 }
@@ -0,0 +1,228 @@
+#include "_png.h"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <string_view>
+
+namespace mplcairo {
+
+// A streaming PNG encoder, writing 8-bit RGBA images (the format is described
+// at https://www.w3.org/TR/PNG/).  Rows are converted to straight RGBA8888 and
+// filtered one at a time, and compressed by blocks using Python's zlib module
+// (which releases the GIL while compressing), so that neither a full copy of
+// the image nor of the encoded output is ever needed.
+
+uint32_t png_crc32(std::string_view data, uint32_t crc = 0)
+{
+  static auto const& table = []() -> std::array<uint32_t, 256> {
+    auto table = std::array<uint32_t, 256>{};
+    for (auto n = 0u; n < 256; ++n) {
+      auto c = n;
+      for (auto k = 0; k < 8; ++k) {
+        c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+      }
+      table[n] = c;
+    }
+    return table;
+  }();
+  crc = ~crc;
+  for (auto const& byte: data) {
+    crc = table[(crc ^ uint8_t(byte)) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+void append_be32(std::string& buf, uint32_t x)
+{
+  buf.push_back(x >> 24);
+  buf.push_back(x >> 16);
+  buf.push_back(x >> 8);
+  buf.push_back(x >> 0);
+}
+
+// The Paeth predictor, in terms of the corresponding bytes of the previous
+// pixel (a), of the previous row (b), and of the previous pixel of the
+// previous row (c).
+uint8_t paeth_predictor(uint8_t a, uint8_t b, uint8_t c)
+{
+  auto const& p = int(a) + int(b) - int(c),
+            & pa = std::abs(p - a),
+            & pb = std::abs(p - b),
+            & pc = std::abs(p - c);
+  return pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+}
+
+// Filter `row` (given the previous, unfiltered, row `prev`) with filter type
+// `type` into `out`, preceded by the filter type byte.
+void filter_row(
+  int type, uint8_t const* row, uint8_t const* prev, ssize_t n, uint8_t* out)
+{
+  auto const bpp = 4;
+  *(out++) = type;
+  for (auto i = 0; i < n; ++i) {
+    auto const& x = row[i],
+              & a = i >= bpp ? row[i - bpp] : uint8_t{},
+              & b = prev[i],
+              & c = i >= bpp ? prev[i - bpp] : uint8_t{};
+    switch (type) {
+      case 0: out[i] = x; break;
+      case 1: out[i] = x - a; break;
+      case 2: out[i] = x - b; break;
+      case 3: out[i] = x - (a + b) / 2; break;
+      case 4: out[i] = x - paeth_predictor(a, b, c); break;
+    }
+  }
+}
+
+// Write the contents of the `surface` (an ARGB32 or RGBA128F image surface) as
+// a PNG to the Python binary file-like `file`.  `metadata` is written as text
+// chunks (tEXt if latin-1-encodable, iTXt otherwise), `dpi` as a pHYs chunk.
+// `filter` is one of "none", "sub", "up", "average", "paeth", or "adaptive"
+// (picking, for each row, the filter minimizing the sum of absolute values of
+// the filtered bytes, as recommended by the PNG specification).
+void write_png(
+  cairo_surface_t* surface, py::object file, py::dict metadata,
+  std::tuple<double, double> dpi, int compress_level, std::string filter)
+{
+  if (auto const& type = cairo_surface_get_type(surface);
+      type != CAIRO_SURFACE_TYPE_IMAGE) {
+    throw std::runtime_error{
+      "_write_png only supports image surfaces, not {}"_format(type)
+      .cast<std::string>()};
+  }
+  auto convert_row = decltype(&argb32_to_straight_rgba8888){};
+  switch (auto const& fmt = cairo_image_surface_get_format(surface);
+          // Avoid "not in enumerated type" warning with CAIRO_FORMAT_RGBA_128F.
+          static_cast<int>(fmt)) {
+    case static_cast<int>(CAIRO_FORMAT_ARGB32):
+      convert_row = argb32_to_straight_rgba8888;
+      break;
+    case 7:  // CAIRO_FORMAT_RGBA_128F.
+      convert_row = rgba128f_to_straight_rgba8888;
+      break;
+    default:
+      throw std::invalid_argument{
+        "_write_png only supports ARGB32 and RGBA128F surfaces, not {}"_format(
+          fmt).cast<std::string>()};
+  }
+  auto const& filters = std::vector<std::string>{
+    "none", "sub", "up", "average", "paeth", "adaptive"};
+  auto const& filter_type =
+    std::find(filters.begin(), filters.end(), filter) - filters.begin();
+  if (filter_type == ssize_t(filters.size())) {
+    throw std::invalid_argument{
+      "invalid PNG filter: {!r}"_format(filter).cast<std::string>()};
+  }
+
+  auto const& write = file.attr("write");
+  auto const& write_chunk = [&](char const* type, std::string_view data) {
+    auto buf = std::string{};
+    buf.reserve(12 + data.size());
+    append_be32(buf, data.size());
+    buf.append(type, 4);
+    buf.append(data);
+    append_be32(buf, png_crc32({buf.data() + 4, 4 + data.size()}));
+    write(py::bytes(buf));
+  };
+
+  cairo_surface_flush(surface);
+  auto const& width = cairo_image_surface_get_width(surface),
+            & height = cairo_image_surface_get_height(surface),
+            & stride = cairo_image_surface_get_stride(surface);
+  auto const& data = cairo_image_surface_get_data(surface);
+
+  write(py::bytes("\x89PNG\r\n\x1a\n", 8));
+  auto ihdr = std::string{};
+  append_be32(ihdr, width);
+  append_be32(ihdr, height);
+  ihdr.append({
+    8,  // Bit depth.
+    6,  // Color type (RGBA).
+    0,  // Compression method.
+    0,  // Filter method.
+    0});  // Interlace method.
+  write_chunk("IHDR", ihdr);
+  auto phys = std::string{};
+  auto const& [dpi_x, dpi_y] = dpi;
+  append_be32(phys, std::lround(dpi_x / .0254));
+  append_be32(phys, std::lround(dpi_y / .0254));
+  phys.push_back(1);  // Unit (meter).
+  write_chunk("pHYs", phys);
+  for (auto const& [key, value]: metadata) {
+    if (value.is_none()) {
+      continue;
+    }
+    auto const& key_s = py::str(key), value_s = py::str(value);
+    auto text = std::string{};
+    try {
+      text =
+        key_s.attr("encode")("latin-1").cast<std::string>() + '\0'
+        + value_s.attr("encode")("latin-1").cast<std::string>();
+      write_chunk("tEXt", text);
+    } catch (py::error_already_set& e) {
+      if (!e.matches(PyExc_UnicodeEncodeError)) {
+        throw;
+      }
+      text =
+        key_s.attr("encode")("latin-1", "replace").cast<std::string>()
+        + std::string{
+          "\0"  // Null separator.
+          "\0"  // Compression flag.
+          "\0"  // Compression method.
+          "\0"  // (Empty) language tag.
+          "\0",  // (Empty) translated keyword.
+          5}
+        + value_s.attr("encode")("utf-8").cast<std::string>();
+      write_chunk("iTXt", text);
+    }
+  }
+
+  auto const& compressobj =
+    py::module::import("zlib").attr("compressobj")(compress_level);
+  auto const& compress = compressobj.attr("compress");
+  auto const& write_idat = [&](py::bytes compressed) {
+    if (auto const& s = std::string{compressed}; s.size()) {
+      write_chunk("IDAT", s);
+    }
+  };
+  auto const& row_size = 4 * width;
+  auto row = std::vector<uint8_t>(row_size),
+       prev = std::vector<uint8_t>(row_size),  // Zero-initialized.
+       candidate = std::vector<uint8_t>(1 + row_size);
+  auto pending = std::string{};
+  auto const& block_size = size_t{1} << 16;
+  pending.reserve(block_size + 1 + row_size);
+  for (auto i = 0; i < height; ++i) {
+    convert_row(data + i * stride, row.data(), width);
+    auto const& offset = pending.size();
+    pending.resize(offset + 1 + row_size);
+    auto const& out = reinterpret_cast<uint8_t*>(pending.data() + offset);
+    if (filter_type < 5) {
+      filter_row(filter_type, row.data(), prev.data(), row_size, out);
+    } else {
+      auto best = std::numeric_limits<uint64_t>::max();
+      for (auto type = 0; type < 5; ++type) {
+        filter_row(type, row.data(), prev.data(), row_size, candidate.data());
+        auto sum = uint64_t{0};
+        for (auto j = 1; j < 1 + row_size; ++j) {
+          sum += std::abs(int8_t(candidate[j]));
+        }
+        if (sum < best) {
+          best = sum;
+          std::copy(candidate.begin(), candidate.end(), out);
+        }
+      }
+    }
+    std::swap(row, prev);
+    if (pending.size() >= block_size) {
+      write_idat(compress(py::bytes(pending)));
+      pending.clear();
+    }
+  }
+  write_idat(compress(py::bytes(pending)));
+  write_idat(compressobj.attr("flush")());
+  write_chunk("IEND", {});
+}
+
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "_util.h"
+
+namespace mplcairo {
+
+namespace py = pybind11;
+
+void write_png(
+  cairo_surface_t* surface, py::object file, py::dict metadata,
+  std::tuple<double, double> dpi, int compress_level, std::string filter);
+
+}
@@ -1,6 +1,9 @@
 #include "_feature_tests.cpp"
+#include "_glyph_atlas.cpp"
+#include "_layout_cache.cpp"
 #include "_mplcairo.cpp"
 #include "_os.cpp"
 #include "_util.cpp"
 #include "_pattern_cache.cpp"
+#include "_png.cpp"
 #include "_raqm.cpp"
@@ -1,9 +1,15 @@
 #include "_util.h"
 
+#include "_os.h"
 #include "_raqm.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
 #include <regex>
 #include <stack>
+#include <thread>
 
 #include "_macros.h"
 
@@ -33,11 +39,19 @@ ITER_CAIRO_OPTIONAL_API(DEFINE_API)
 
 // Other useful values.
 std::unordered_map<std::string, cairo_font_face_t*> FONT_CACHE{};
-cairo_user_data_key_t const REFS_KEY{}, STATE_KEY{}, FT_KEY{};
+cairo_user_data_key_t const
+  REFS_KEY{}, STATE_KEY{}, FT_KEY{}, WRITER_KEY{};
 py::object UNIT_CIRCLE{py::none{}}, PIXEL_MARKER{py::none{}};
 bool FLOAT_SURFACE{};
+bool GLYPH_ATLAS{};
+size_t LAYOUT_CACHE_SIZE{4096};
 int MARKER_THREADS{};
 double MITER_LIMIT{10.};
+bool PATH_DECIMATION{};
+size_t PATTERN_CACHE_BYTES{size_t{1} << 26};
+bool PROFILE{};
+bool RELEASE_GIL{};
+size_t SURFACE_POOL_BYTES{size_t{1} << 26};
 MplcairoScriptSurface MPLCAIRO_SCRIPT_SURFACE{
   []() -> MplcairoScriptSurface {
     if (auto script_surface = std::getenv("MPLCAIRO_SCRIPT_SURFACE");
@@ -68,6 +82,166 @@ double AdditionalState::get_hatch_linewidth() {
   return *hatch_linewidth;
 }
 
+ReleaseGIL::ReleaseGIL()
+{
+  if (detail::RELEASE_GIL) {
+    release_.emplace();
+  }
+}
+
+StreamWriter::StreamWriter(py::object file) : file_{file}
+{
+  buf_.reserve(BLOCK_SIZE);
+  // Only bypass the Python-level file object when its buffering is known to
+  // be a plain passthrough (e.g., GzipFile also has a fileno(), which refers
+  // to the *compressed* stream).
+  auto const& io = py::module::import("io");
+  auto const& type = file.get_type();
+  if (type.is(io.attr("BufferedWriter")) || type.is(io.attr("FileIO"))) {
+    file.attr("flush")();
+    // Buffered writers over in-memory raw streams (e.g. BytesIO) have no fd,
+    // and raise io.UnsupportedOperation (an OSError); keep using write().
+    try {
+      fd_ = file.attr("fileno")().cast<int>();
+    } catch (py::error_already_set& e) {
+      if (!e.matches(PyExc_OSError)) {
+        throw;
+      }
+    }
+  }
+}
+
+StreamWriter::~StreamWriter()
+{
+  try {
+    finish();
+  } catch (std::exception const& e) {
+    std::cerr << "Exception ignored in stream writer: " << e.what() << "\n";
+  }
+}
+
+void StreamWriter::flush()
+{
+  if (buf_.empty()) {
+    return;
+  }
+  if (fd_) {
+    if (!os::write(
+          *fd_, reinterpret_cast<char const*>(buf_.data()), buf_.size())) {
+      throw std::runtime_error{"write() failed: "s + std::strerror(errno)};
+    }
+  } else {
+    // The GIL may have been released around the cairo call that triggered
+    // the write.
+    auto const& gil = py::gil_scoped_acquire{};
+    auto const& length = buf_.size();
+    auto const& buf_info = py::buffer_info{
+      buf_.data(), sizeof(char), py::format_descriptor<char>::format(),
+      1, {length}, {sizeof(char)}};
+    auto const& written = file_.attr("write")(py::memoryview{buf_info});
+    // Some file-likes return None from write(), in which case we can only
+    // assume success.
+    if (!written.is_none() && written.cast<size_t>() != length) {
+      throw std::runtime_error{
+        "short write: {} out of {} bytes"_format(written, length)
+        .cast<std::string>()};
+    }
+  }
+  buf_.clear();
+}
+
+cairo_status_t StreamWriter::write(
+  void* closure, unsigned char const* data, unsigned int length)
+{
+  auto const& writer = static_cast<StreamWriter*>(closure);
+  if (writer->error_) {
+    return CAIRO_STATUS_WRITE_ERROR;
+  }
+  writer->buf_.insert(writer->buf_.end(), data, data + length);
+  if (writer->buf_.size() >= BLOCK_SIZE) {
+    try {
+      writer->flush();
+    } catch (...) {
+      writer->error_ = std::current_exception();
+      // NOTE: This does not appear to affect the context status.
+      return CAIRO_STATUS_WRITE_ERROR;
+    }
+  }
+  return CAIRO_STATUS_SUCCESS;
+}
+
+void StreamWriter::finish()
+{
+  if (!error_) {
+    try {
+      flush();
+    } catch (...) {
+      error_ = std::current_exception();
+    }
+  }
+  if (fd_) {
+    // Resync the Python file object's idea of the current position.
+    auto const& gil = py::gil_scoped_acquire{};
+    if (file_.attr("seekable")().cast<bool>()) {
+      file_.attr("seek")(0, 1);
+    }
+  }
+  if (error_ && !reported_) {
+    reported_ = true;
+    std::rethrow_exception(error_);
+  }
+}
+
+namespace {
+thread_local Stats* current_stats{};
+}
+
+Timed::Timed(Stats* stats, char const* name, size_t items) :
+  prev_stats_{current_stats}, entry_{}
+{
+  if (detail::PROFILE && stats) {
+    current_stats = stats;
+    entry_ = &stats->entries[name];
+    entry_->calls++;
+    entry_->items += items;
+    start_ = std::chrono::steady_clock::now();
+  }
+}
+
+Timed::Timed(char const* name, size_t items) :
+  Timed{current_stats, name, items}
+{}
+
+Timed::Timed(Stats& stats, char const* name, size_t items) :
+  Timed{&stats, name, items}
+{}
+
+Timed::~Timed()
+{
+  if (entry_) {
+    entry_->seconds +=
+      std::chrono::duration<double>{
+        std::chrono::steady_clock::now() - start_}.count();
+    current_stats = prev_stats_;
+  }
+}
+
+void Timed::add_items(size_t items)
+{
+  if (entry_) {
+    entry_->items += items;
+  }
+}
+
+void record_stat(char const* name, size_t items)
+{
+  if (detail::PROFILE && current_stats) {
+    auto& entry = current_stats->entries[name];
+    entry.calls++;
+    entry.items += items;
+  }
+}
+
 GlyphsAndClusters::~GlyphsAndClusters() {
   cairo_glyph_free(glyphs);
   cairo_text_cluster_free(clusters);
@@ -92,15 +266,196 @@ cairo_format_t get_cairo_format() {
     ? static_cast<cairo_format_t>(7) : CAIRO_FORMAT_ARGB32;
 }
 
+namespace {
+
+double check_rgba_component(double v)
+{
+  if (v < 0 || v > 1) {  // Let nans through, as Matplotlib does.
+    throw std::invalid_argument{"RGBA values should be within 0-1 range"};
+  }
+  return v;
+}
+
+// Whether `s` is "none", case-insensitively.
+bool is_none_color(std::string s)
+{
+  std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) -> char {
+    return std::tolower(c);
+  });
+  return s == "none";
+}
+
+// Convert colors given as 3 or 4 Python floats or ints, or as a 1D float64
+// array of size 3 or 4, natively.
+std::optional<rgba_t> rgba_from_sequence(py::handle color)
+{
+  auto components = std::array<double, 4>{0, 0, 0, 1};
+  if (py::isinstance<py::tuple>(color) || py::isinstance<py::list>(color)) {
+    auto const& seq = color.cast<py::sequence>();
+    auto const& size = seq.size();
+    if (size != 3 && size != 4) {
+      return {};
+    }
+    for (size_t i = 0; i < size; ++i) {
+      auto const& item = seq[i];
+      if (!PyFloat_Check(item.ptr()) && !PyLong_Check(item.ptr())) {
+        return {};
+      }
+      components[i] = check_rgba_component(item.cast<double>());
+    }
+  } else if (py::isinstance<py::array_t<double>>(color)) {
+    auto const& arr = color.cast<py::array_t<double>>();
+    if (arr.ndim() != 1 || (arr.shape(0) != 3 && arr.shape(0) != 4)) {
+      return {};
+    }
+    auto const& raw = arr.unchecked<1>();
+    for (auto i = 0; i < arr.shape(0); ++i) {
+      components[i] = check_rgba_component(raw(i));
+    }
+  } else {
+    return {};
+  }
+  auto const& [r, g, b, a] = components;
+  return rgba_t{r, g, b, a};
+}
+
+// Convert a named or hex color, caching the conversions (but not of "CN"
+// colors, which depend on the property cycle, as in Matplotlib's own cache).
+// Matplotlib is only called once per string, with the GIL held (which also
+// protects the cache).
+std::optional<rgba_t> rgba_from_string(py::handle color)
+{
+  if (!py::isinstance<py::str>(color)) {
+    return {};
+  }
+  auto const& s = color.cast<std::string>();
+  if (s.size() > 1 && s[0] == 'C'
+      && std::all_of(s.begin() + 1, s.end(), [](unsigned char c) -> bool {
+           return std::isdigit(c);
+         })) {
+    return {};
+  }
+  static auto cache = std::unordered_map<std::string, rgba_t>{};
+  auto it = cache.find(s);
+  if (it == cache.end()) {
+    auto const& timed = Timed{"to_rgba"};
+    auto const& rgba =
+      py::module::import("matplotlib.colors").attr("to_rgba")(color)
+      .cast<rgba_t>();
+    if (cache.size() >= 1024) {  // NOTE: Arbitrary limit.
+      cache.clear();  // Naive cache mechanism.
+    }
+    it = cache.emplace(s, rgba).first;
+  }
+  return it->second;
+}
+
+template<typename T>
+py::array_t<double> rgba_array_from_array(
+  py::array_t<T> colors, double scale, std::optional<double> alpha)
+{
+  auto const& raw = colors.template unchecked<2>();
+  auto const& n = raw.shape(0), & m = raw.shape(1);
+  auto out = py::array_t<double>{{n, ssize_t{4}}};
+  auto out_raw = out.template mutable_unchecked<2>();
+  for (auto i = 0; i < n; ++i) {
+    for (auto j = 0; j < m; ++j) {
+      out_raw(i, j) = check_rgba_component(raw(i, j) / scale);
+    }
+    if (m == 3) {
+      out_raw(i, 3) = 1;
+    }
+    if (alpha) {
+      out_raw(i, 3) = *alpha;
+    }
+  }
+  return out;
+}
+
+}
+
+// Convert `color` to RGBA as matplotlib.colors.to_rgba, natively for tuples
+// and arrays of floats, and for (cached) named or hex colors.
 rgba_t to_rgba(py::object color, std::optional<double> alpha)
 {
+  auto rgba = rgba_from_sequence(color);
+  if (!rgba) {
+    rgba = rgba_from_string(color);
+    if (rgba && alpha && is_none_color(color.cast<std::string>())) {
+      return *rgba;  // Fully transparent, regardless of alpha.
+    }
+  }
+  if (!rgba) {
+    auto const& timed = Timed{"to_rgba"};
+    return
+      py::module::import("matplotlib.colors")
+      .attr("to_rgba")(color, alpha).cast<rgba_t>();
+  }
+  if (alpha) {
+    std::get<3>(*rgba) = *alpha;
+  }
+  return *rgba;
+}
+
+// Convert `colors` to a (n, 4) array as matplotlib.colors.to_rgba_array,
+// natively for (n, 3) or (n, 4) float arrays and uint8 arrays (with values
+// from 0 to 255), and for strings and sequences of strings (see to_rgba).
+py::array_t<double> to_rgba_array(
+  py::object colors, std::optional<double> alpha)
+{
+  if (colors.get_type().is(py::module::import("numpy").attr("ndarray"))) {
+    auto const& arr = colors.cast<py::array>();
+    if (arr.ndim() == 2 && (arr.shape(1) == 3 || arr.shape(1) == 4)) {
+      if (py::isinstance<py::array_t<double>>(arr)) {
+        return rgba_array_from_array(
+          arr.cast<py::array_t<double>>(), 1, alpha);
+      } else if (py::isinstance<py::array_t<float>>(arr)) {
+        return rgba_array_from_array(arr.cast<py::array_t<float>>(), 1, alpha);
+      } else if (py::isinstance<py::array_t<uint8_t>>(arr)) {
+        return rgba_array_from_array(
+          arr.cast<py::array_t<uint8_t>>(), 255, alpha);
+      }
+    }
+  } else if (py::isinstance<py::str>(colors)
+             || ((py::isinstance<py::tuple>(colors)
+                  || py::isinstance<py::list>(colors))
+                 && py::len(colors)
+                 && std::all_of(
+                   colors.begin(), colors.end(),
+                   [](py::handle color) -> bool {
+                     return py::isinstance<py::str>(color);
+                   }))) {
+    auto items = py::list{};
+    if (py::isinstance<py::str>(colors)) {
+      if (is_none_color(colors.cast<std::string>())) {
+        // As Matplotlib, return no colors at all.
+        return py::array_t<double>{{ssize_t{0}, ssize_t{4}}};
+      }
+      items.append(colors);
+    } else {
+      for (auto const& color: colors) {
+        items.append(color);
+      }
+    }
+    auto const& n = ssize_t(py::len(items));
+    auto out = py::array_t<double>{{n, ssize_t{4}}};
+    auto out_raw = out.mutable_unchecked<2>();
+    for (auto i = 0; i < n; ++i) {
+      auto const& [r, g, b, a] = to_rgba(items[i], alpha);
+      out_raw(i, 0) = r; out_raw(i, 1) = g;
+      out_raw(i, 2) = b; out_raw(i, 3) = a;
+    }
+    return out;
+  }
+  auto const& timed = Timed{"to_rgba_array"};
   return
-    py::module::import("matplotlib.colors")
-    .attr("to_rgba")(color, alpha).cast<rgba_t>();
+    py::module::import("matplotlib.colors").attr("to_rgba_array")(
+      colors, alpha ? py::cast(*alpha) : py::none());
 }
 
 cairo_matrix_t matrix_from_transform(py::object transform, double y0)
 {
+  auto const& timed = Timed{"matrix_from_transform"};
   if (!py::bool_(py::getattr(transform, "is_affine", py::bool_(true)))) {
     throw std::invalid_argument{"only affine transforms are handled"};
   }
@@ -119,6 +474,7 @@ cairo_matrix_t matrix_from_transform(py::object transform, double y0)
 cairo_matrix_t matrix_from_transform(
   py::object transform, cairo_matrix_t const* master_matrix)
 {
+  auto const& timed = Timed{"matrix_from_transform"};
   if (!py::bool_(py::getattr(transform, "is_affine", py::bool_(true)))) {
     throw std::invalid_argument{"only affine transforms are handled"};
   }
@@ -162,6 +518,24 @@ bool has_vector_surface(cairo_t* cr)
   }
 }
 
+bool Bounds::intersects(double x0, double y0, double x1, double y1) const
+{
+  return x0 < this->x1 && this->x0 < x1 && y0 < this->y1 && this->y0 < y1;
+}
+
+Bounds get_cull_bounds(cairo_t* cr)
+{
+  auto const& inf = std::numeric_limits<double>::infinity();
+  if (cairo_surface_get_type(cairo_get_group_target(cr))
+      != CAIRO_SURFACE_TYPE_IMAGE) {
+    return {-inf, -inf, inf, inf};
+  }
+  // For image surfaces, the clip extents are also bounded by the surface.
+  double x0, y0, x1, y1;
+  cairo_clip_extents(cr, &x0, &y0, &x1, &y1);
+  return {x0, y0, x1, y1};
+}
+
 // Same as GraphicsContextRenderer::get_additional_state() but with checking
 // for cairo_t*'s that we may not have initialized.
 AdditionalState& get_additional_state(cairo_t* cr)
@@ -194,6 +568,74 @@ AdditionalState& get_additional_state(cairo_t* cr)
 // to be within the clip rectangle -- cairo will run its own clipping later
 // anyways.
 
+// Transform the `n` points (xs[i * stride], ys[i * stride]) by `matrix`,
+// writing them (interleaved) to `out`, and whether they are finite to
+// `finite`, if not null.  `out` may alias the input.  The loops are kept
+// branchless so that compilers can vectorize them (which is not possible when
+// calling cairo_matrix_transform_point once per point); the arithmetic is the
+// same as cairo's, so the results are identical.
+void transform_points(
+  cairo_matrix_t const* matrix, ssize_t n,
+  double const* xs, double const* ys, ssize_t stride,
+  double* out, bool* finite)
+{
+  // Copy the matrix, as it may otherwise alias `out`.
+  auto const [xx, yx, xy, yy, x0, y0] = *matrix;
+  if (stride == 2 && ys == xs + 1) {
+    for (auto i = 0; i < n; ++i) {
+      auto const x = xs[2 * i], y = xs[2 * i + 1];
+      out[2 * i] = (xx * x + xy * y) + x0;
+      out[2 * i + 1] = (yx * x + yy * y) + y0;
+    }
+  } else {
+    for (auto i = 0; i < n; ++i) {
+      auto const x = xs[i * stride], y = ys[i * stride];
+      out[2 * i] = (xx * x + xy * y) + x0;
+      out[2 * i + 1] = (yx * x + yy * y) + y0;
+    }
+  }
+  if (finite) {
+    for (auto i = 0; i < n; ++i) {
+      // v - v is zero for finite v, and nan for infinite or nan v.
+      finite[i] =
+        (out[2 * i] - out[2 * i] == 0)
+        & (out[2 * i + 1] - out[2 * i + 1] == 0);
+    }
+  }
+}
+
+// Transform vertices[start:stop] (see transform_points).
+void transform_vertices(
+  py::detail::unchecked_reference<double, 2> const& vertices,
+  ssize_t start, ssize_t stop, cairo_matrix_t const* matrix,
+  double* out, bool* finite)
+{
+  if (start >= stop) {
+    return;
+  }
+  auto const& xs = vertices.data(start, 0),
+            & ys = vertices.data(start, 1);
+  auto const& stride = stop - start > 1 ? vertices.data(start + 1, 0) - xs : 2;
+  transform_points(matrix, stop - start, xs, ys, stride, out, finite);
+}
+
+TransformedVertices::TransformedVertices(
+  py::detail::unchecked_reference<double, 2> const& vertices,
+  cairo_matrix_t const* matrix) :
+  vertices_{vertices}, matrix_{matrix}, start_{0}, stop_{0}
+{}
+
+std::tuple<double, double, bool> TransformedVertices::operator()(ssize_t i)
+{
+  if (!(start_ <= i && i < stop_)) {
+    start_ = i;
+    stop_ = std::min(i + BLOCK_SIZE, vertices_.shape(0));
+    transform_vertices(vertices_, start_, stop_, matrix_, xys_, finite_);
+  }
+  auto const& k = i - start_;
+  return {xys_[2 * k], xys_[2 * k + 1], finite_[k]};
+}
+
 // A helper to store the CTM without the need to cairo_save() the full state.
 // (We can't simply call cairo_transform(cr, matrix) because matrix may be
 // degenerate (e.g., for zero-sized markers).  Fortunately, the cost of doing
@@ -235,6 +677,7 @@ struct LoadPathContext {
 void load_path_exact(
   cairo_t* cr, py::object path, cairo_matrix_t const* matrix)
 {
+  auto timed = Timed{"load_path_exact"};
   auto const& min = double(-(1 << 22)), max = double(1 << 22);
   auto const& lpc = LoadPathContext{cr};
 
@@ -248,6 +691,7 @@ void load_path_exact(
       "vertices must have shape (n, 2), not {.shape}"_format(
         path.attr("vertices")).cast<std::string>()};
   }
+  timed.add_items(n);
   if (!codes_keepref) {
     load_path_exact(cr, vertices_keepref, 0, n, matrix);
     return;
@@ -260,11 +704,10 @@ void load_path_exact(
         n, codes.shape(0)).cast<std::string>()};
   }
   auto const& snapper = lpc.snapper;
+  auto transformed = TransformedVertices{vertices, matrix};
   // Main loop.
   for (auto i = 0; i < n; ++i) {
-    auto x0 = vertices(i, 0), y0 = vertices(i, 1);
-    cairo_matrix_transform_point(matrix, &x0, &y0);
-    auto const& is_finite = std::isfinite(x0) && std::isfinite(y0);
+    auto [x0, y0, is_finite] = transformed(i);
     // Better(?) than nothing.
     x0 = std::clamp(x0, min, max);
     y0 = std::clamp(y0, min, max);
@@ -290,10 +733,8 @@ void load_path_exact(
       // is finite, it sets the current point for the next curve; otherwise, a
       // new sub-path is created.
       case PathCode::CURVE3: {
-        auto x1 = vertices(i + 1, 0), y1 = vertices(i + 1, 1);
-        cairo_matrix_transform_point(matrix, &x1, &y1);
+        auto [x1, y1, last_finite] = transformed(i + 1);
         i += 1;
-        auto const& last_finite = std::isfinite(x1) && std::isfinite(y1);
         if (last_finite) {
           x1 = std::clamp(x1, min, max);
           y1 = std::clamp(y1, min, max);
@@ -313,19 +754,15 @@ void load_path_exact(
         break;
       }
       case PathCode::CURVE4: {
-        auto x1 = vertices(i + 1, 0), y1 = vertices(i + 1, 1),
-             x2 = vertices(i + 2, 0), y2 = vertices(i + 2, 1);
-        cairo_matrix_transform_point(matrix, &x1, &y1);
-        cairo_matrix_transform_point(matrix, &x2, &y2);
+        auto [x1, y1, mid_finite] = transformed(i + 1);
+        auto [x2, y2, last_finite] = transformed(i + 2);
         i += 2;
-        auto const& last_finite = std::isfinite(x2) && std::isfinite(y2);
         if (last_finite) {
           x1 = std::clamp(x1, min, max);
           y1 = std::clamp(y1, min, max);
           x2 = std::clamp(x2, min, max);
           y2 = std::clamp(y2, min, max);
-          if (is_finite && std::isfinite(x1) && std::isfinite(y1)
-              && cairo_has_current_point(cr)) {
+          if (is_finite && mid_finite && cairo_has_current_point(cr)) {
             cairo_curve_to(cr, x0, y0, x1, y1, snapper(x2), snapper(y2));
           } else {
             cairo_move_to(cr, snapper(x2), snapper(y2));
@@ -344,12 +781,30 @@ void load_path_exact(
 
 // This overload implements the case of a codeless path.  Exposing start and
 // stop in the signature helps implementing support for agg.path.chunksize.
+// If `cull` is set, the path is only meant to be stroked (without dashes), so
+// that segments can be clipped to the cull bounds (see get_cull_bounds),
+// enlarged by the extent of caps and joins, rather than to the (much larger)
+// box that cairo can handle.
 void load_path_exact(
   cairo_t* cr, py::array_t<double> vertices_keepref,
-  ssize_t start, ssize_t stop, cairo_matrix_t const* matrix)
+  ssize_t start, ssize_t stop, cairo_matrix_t const* matrix,
+  bool decimate, bool cull)
 {
-  auto const min = double(-(1 << 22)), max = double(1 << 22);
+  auto x_min = double(-(1 << 22)), x_max = double(1 << 22),
+       y_min = x_min, y_max = x_max;
   auto const& lpc = LoadPathContext{cr};
+  if (cull) {
+    auto const& bounds = get_cull_bounds(cr);
+    // Caps extend by at most lw/2 * sqrt(2), and (miter) joins by at most
+    // lw/2 * miter_limit, beyond the vertices; add a pixel for antialiasing.
+    auto const& margin =
+      cairo_get_line_width(cr) / 2 * std::max(cairo_get_miter_limit(cr), 2.)
+      + 1;
+    x_min = std::max(x_min, bounds.x0 - margin);
+    x_max = std::min(x_max, bounds.x1 + margin);
+    y_min = std::max(y_min, bounds.y0 - margin);
+    y_max = std::min(y_max, bounds.y1 + margin);
+  }
 
   auto const& vertices = vertices_keepref.unchecked<2>();
   auto const& n = vertices.shape(0);
@@ -360,37 +815,38 @@ void load_path_exact(
   }
   auto const& snapper = lpc.snapper;
 
-  auto path_data = std::vector<cairo_path_data_t>{};
+  // Reuse a per-thread buffer across calls (the data is copied out by
+  // cairo_append_path), but don't hold on to its memory if it got large.
+  thread_local auto path_data_buffer = std::vector<cairo_path_data_t>{};
+  auto& path_data = path_data_buffer;
+  path_data.clear();
   path_data.reserve(2 * (stop - start));
   auto const LEFT = 1 << 0, RIGHT = 1 << 1, BOTTOM = 1 << 2, TOP = 1 << 3;
   auto const& outcode = [&](double x, double y) -> int {
     auto code = 0;
-    if (x < min) {
+    if (x < x_min) {
       code |= LEFT;
-    } else if (x > max) {
+    } else if (x > x_max) {
       code |= RIGHT;
     }
-    if (y < min) {
+    if (y < y_min) {
       code |= BOTTOM;
-    } else if (y > max) {
+    } else if (y > y_max) {
       code |= TOP;
     }
     return code;
   };
   // The previous point, if any, before clipping and snapping.
   auto prev = std::optional<std::tuple<double, double>>{};
-  // Main loop.
-  for (auto i = start; i < stop; ++i) {
-    auto x = vertices(i, 0), y = vertices(i, 1);
-    cairo_matrix_transform_point(matrix, &x, &y);
-    if (std::isfinite(x) && std::isfinite(y)) {
+  auto const& add_point = [&](double x, double y, bool is_finite) -> void {
+    if (is_finite) {
       cairo_path_data_t header, point;
       if (prev) {
         header.header = {CAIRO_PATH_LINE_TO, 2};
         auto [x_prev, y_prev] = *prev;
         prev = {x, y};
         // Cohen-Sutherland clipping: we expect most segments to be within
-        // the 1 << 22 by 1 << 22 box.
+        // the box (by default, the 1 << 22 by 1 << 22 box).
         auto code0 = outcode(x_prev, y_prev);
         auto code1 = outcode(x, y);
         auto accept = false, update_prev = false;
@@ -404,17 +860,17 @@ void load_path_exact(
             auto xc = 0., yc = 0.;
             auto code = code0 ? code0 : code1;
             if (code & TOP) {
-              xc = x_prev + (x - x_prev) * (max - y_prev) / (y - y_prev);
-              yc = max;
+              xc = x_prev + (x - x_prev) * (y_max - y_prev) / (y - y_prev);
+              yc = y_max;
             } else if (code & BOTTOM) {
-              xc = x_prev + (x - x_prev) * (min - y_prev) / (y - y_prev);
-              yc = min;
+              xc = x_prev + (x - x_prev) * (y_min - y_prev) / (y - y_prev);
+              yc = y_min;
             } else if (code & RIGHT) {
-              yc = y_prev + (y - y_prev) * (max - x_prev) / (x - x_prev);
-              xc = max;
+              yc = y_prev + (y - y_prev) * (x_max - x_prev) / (x - x_prev);
+              xc = x_max;
             } else if (code & LEFT) {
-              yc = y_prev + (y - y_prev) * (min - x_prev) / (x - x_prev);
-              xc = min;
+              yc = y_prev + (y - y_prev) * (x_min - x_prev) / (x - x_prev);
+              xc = x_min;
             }
             if (code == code0) {
               update_prev = true;
@@ -468,11 +924,74 @@ void load_path_exact(
     } else {
       prev = {};
     }
+  };
+  auto transformed = TransformedVertices{vertices, matrix};
+  if (!decimate) {
+    for (auto i = start; i < stop; ++i) {
+      auto const& [x, y, is_finite] = transformed(i);
+      add_point(x, y, is_finite);
+    }
+  } else {
+    // Collapse each run of consecutive points within the same pixel column to
+    // its first, lowest, highest and last points (in their original order),
+    // which outline the same stroke, so that the stroking cost depends on the
+    // canvas width rather than on the number of points.
+    struct Point {
+      ssize_t idx;  // Within the run.
+      double x, y;
+    };
+    auto run_col = 0.;
+    auto run_size = ssize_t{0};
+    Point first, lowest, highest, last;
+    auto const& flush = [&]() -> void {
+      if (!run_size) {
+        return;
+      }
+      add_point(first.x, first.y, true);
+      auto const& [p, q] =
+        lowest.idx < highest.idx
+        ? std::tuple{lowest, highest} : std::tuple{highest, lowest};
+      if (0 < p.idx && p.idx < run_size - 1) {
+        add_point(p.x, p.y, true);
+      }
+      if (p.idx < q.idx && q.idx < run_size - 1) {
+        add_point(q.x, q.y, true);
+      }
+      if (run_size > 1) {
+        add_point(last.x, last.y, true);
+      }
+      run_size = 0;
+    };
+    for (auto i = start; i < stop; ++i) {
+      auto const& [x, y, is_finite] = transformed(i);
+      if (!is_finite) {
+        flush();
+        add_point(x, y, false);
+        continue;
+      }
+      auto const& col = std::floor(x);
+      if (!run_size || col != run_col) {
+        flush();
+        run_col = col;
+        first = lowest = highest = {0, x, y};
+      } else if (y < lowest.y) {
+        lowest = {run_size, x, y};
+      } else if (y > highest.y) {
+        highest = {run_size, x, y};
+      }
+      last = {run_size, x, y};
+      ++run_size;
+    }
+    flush();
   }
   auto const& path =
     cairo_path_t{
       CAIRO_STATUS_SUCCESS, path_data.data(), int(path_data.size())};
   cairo_append_path(cr, &path);
+  if (path_data.capacity() * sizeof(cairo_path_data_t)
+      > SCRATCH_BYTES) {
+    path_data = {};
+  }
 }
 
 // Fill and/or stroke `path` onto `cr` after transformation by `matrix`,
@@ -481,6 +1000,7 @@ void fill_and_stroke_exact(
   cairo_t* cr, py::object path, cairo_matrix_t const* matrix,
   std::optional<rgba_t> fill, std::optional<rgba_t> stroke)
 {
+  auto const& timed = Timed{"fill_and_stroke_exact"};
   cairo_save(cr);
   auto path_loaded = false;
   if (fill) {
@@ -522,6 +1042,338 @@ void fill_and_stroke_exact(
   cairo_restore(cr);
 }
 
+// Call `draw(ctx, i)` for each i in [0, n), to draw the items in order onto
+// `cr` (or a context targeting a part of it).  `rows(i)` returns the vertical
+// extents, in user space, of item i.  If `n_threads` is nonzero, the items
+// are drawn in parallel:
+// - If the user-to-device transform of `cr` is a translation and its target
+//   an image surface, then the canvas is split into horizontal bands, each of
+//   which is backed by the target's own buffer and gets all the items that
+//   intersect it (items spanning multiple bands are drawn, clipped, in each
+//   of them).  Each pixel belongs to a single band, so this is equivalent to
+//   drawing all items onto `cr` in order, without needing any temporaries.
+// - Otherwise, [0, n) is split into contiguous chunks that are drawn in
+//   parallel onto separate scratch surfaces, which are then composited onto
+//   `cr` in order (for the OVER operator, this is equivalent to drawing all
+//   items onto `cr` in order, as OVER is associative).
+// The callbacks must not touch Python objects, nor throw.
+void draw_threaded(
+  cairo_t* cr, int n_threads, ssize_t n,
+  std::function<std::tuple<double, double>(ssize_t)> const& rows,
+  std::function<void(cairo_t*, ssize_t)> const& draw)
+{
+  if (!n_threads) {
+    for (auto i = 0; i < n; ++i) {
+      draw(cr, i);
+    }
+    return;
+  }
+  if (!n) {
+    return;
+  }
+  if (!draw_banded(
+        cr, n_threads, n, rows,
+        [&](cairo_t* ctx, std::vector<ssize_t> const& items) -> void {
+          for (auto const& i: items) {
+            draw(ctx, i);
+          }
+        })) {
+    draw_chunked(cr, n_threads, n, draw);
+  }
+}
+
+// If the user-to-device transform of `cr` is a translation and its target an
+// image surface, call `draw_band(ctx, items)` in parallel for each horizontal
+// band of the canvas (see draw_threaded), with `items` listing, in order, the
+// i in [0, n) whose vertical extents `rows(i)` intersect the band, and return
+// true.  Otherwise, draw nothing and return false.
+bool draw_banded(
+  cairo_t* cr, int n_threads, ssize_t n,
+  std::function<std::tuple<double, double>(ssize_t)> const& rows,
+  std::function<void(cairo_t*, std::vector<ssize_t> const&)> const& draw_band)
+{
+  auto const& target = cairo_get_group_target(cr);
+  double tx = 0, ty = 0, x1 = 1, y1 = 0, x2 = 0, y2 = 1;
+  cairo_user_to_device(cr, &tx, &ty);
+  cairo_user_to_device(cr, &x1, &y1);
+  cairo_user_to_device(cr, &x2, &y2);
+  if (cairo_surface_get_type(target) != CAIRO_SURFACE_TYPE_IMAGE
+      || x1 - tx != 1 || y1 - ty != 0 || x2 - tx != 0 || y2 - ty != 1) {
+    return false;
+  }
+  auto const& clip = std::unique_ptr<
+    cairo_rectangle_list_t, decltype(&cairo_rectangle_list_destroy)>{
+      cairo_copy_clip_rectangle_list(cr), cairo_rectangle_list_destroy};
+  if (clip->status != CAIRO_STATUS_SUCCESS) {
+    return false;
+  }
+  auto const& data = cairo_image_surface_get_data(target);
+  auto const& format = cairo_image_surface_get_format(target);
+  auto const& width = cairo_image_surface_get_width(target),
+            & height = cairo_image_surface_get_height(target),
+            & stride = cairo_image_surface_get_stride(target);
+  if (!height) {
+    return true;
+  }
+  // Use more bands than threads, for load balancing.
+  auto const& n_bands = std::min(height, 4 * n_threads),
+            & band_height = (height + n_bands - 1) / n_bands;
+  auto bins = std::vector<std::vector<ssize_t>>(n_bands);
+  for (auto i = 0; i < n; ++i) {
+    auto const& [y0, y1] = rows(i);
+    auto const& r0 = std::max(std::floor(y0 + ty), 0.),
+              & r1 = std::min(std::ceil(y1 + ty), double(height));
+    if (!(r0 < r1)) {  // Also skips nans.
+      continue;
+    }
+    for (auto b = int(r0) / band_height; b <= (int(r1) - 1) / band_height;
+         ++b) {
+      bins[b].push_back(i);
+    }
+  }
+  auto const& op = cairo_get_operator(cr);
+  auto next_band = std::atomic<int>{0};
+  auto const& worker = [&]() -> void {
+    for (int b; (b = next_band++) < n_bands;) {
+      if (bins[b].empty()) {
+        continue;
+      }
+      auto const& r0 = b * band_height,
+                & r1 = std::min(r0 + band_height, height);
+      auto const& surface =
+        cairo_image_surface_create_for_data(
+          data + r0 * stride, format, width, r1 - r0, stride);
+      cairo_surface_set_device_offset(surface, tx, ty - r0);
+      auto const& ctx = cairo_create(surface);
+      cairo_surface_destroy(surface);
+      cairo_set_operator(ctx, op);
+      for (auto j = 0; j < clip->num_rectangles; ++j) {
+        auto const& rect = clip->rectangles[j];
+        cairo_rectangle(ctx, rect.x, rect.y, rect.width, rect.height);
+      }
+      cairo_clip(ctx);
+      draw_band(ctx, bins[b]);
+      cairo_destroy(ctx);
+    }
+  };
+  cairo_surface_flush(target);
+  auto threads = std::vector<std::thread>{};
+  for (auto i = 0; i < std::min(n_threads, n_bands); ++i) {
+    threads.emplace_back(worker);
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+  cairo_surface_mark_dirty(target);
+  return true;
+}
+
+void draw_chunked(
+  cairo_t* cr, int n_threads, ssize_t n,
+  std::function<void(cairo_t*, ssize_t)> const& draw)
+{
+  auto const& state = get_additional_state(cr);
+  auto const& chunk_size = (n + n_threads - 1) / n_threads;
+  auto ctxs = std::vector<cairo_t*>{};
+  auto threads = std::vector<std::thread>{};
+  for (auto start = ssize_t{0}; start < n; start += chunk_size) {
+    auto const& surface =
+      cairo_surface_create_similar_image(
+        cairo_get_target(cr), get_cairo_format(),
+        int(state.width), int(state.height));
+    auto const& ctx = cairo_create(surface);
+    cairo_surface_destroy(surface);
+    ctxs.push_back(ctx);
+    threads.emplace_back(
+      [&, ctx, start]() -> void {
+        for (auto i = start; i < std::min(start + chunk_size, n); ++i) {
+          draw(ctx, i);
+        }
+      });
+  }
+  for (auto& thread: threads) {
+    thread.join();
+  }
+  cairo_save(cr);
+  for (auto const& ctx: ctxs) {
+    auto const& pattern =
+      cairo_pattern_create_for_surface(cairo_get_target(ctx));
+    cairo_destroy(ctx);
+    cairo_set_source(cr, pattern);
+    cairo_pattern_destroy(pattern);
+    cairo_paint(cr);
+  }
+  cairo_restore(cr);
+}
+
+// Draw a rectilinear quad mesh, i.e. one whose (transformed) vertices
+// `coords`, a C-contiguous (height + 1, width + 1, 2) array, have x only
+// depending on the column and y only on the row, as a single image of the
+// colors `fc(n)` of the quads, instead of one mesh patch per quad:
+// - If the user-to-device transform of `cr` is a translation and its target
+//   an image surface, each pixel whose center lies within the mesh directly
+//   gets the color of the quad containing that center (as when rasterizing
+//   the mesh), whatever the spacing of the edges.
+// - Otherwise, if the edges are evenly spaced, the quad colors are painted as
+//   an image scaled with the NEAREST filter.
+// Return whether the mesh was drawn.
+bool draw_rectilinear_mesh(
+  cairo_t* cr, ssize_t width, ssize_t height, double const* coords,
+  std::function<rgba_t(ssize_t)> const& fc)
+{
+  if (!width || !height) {
+    return false;
+  }
+  auto const& coord = [&](ssize_t i, ssize_t j, ssize_t k) -> double {
+    return coords[2 * (i * (width + 1) + j) + k];
+  };
+  auto xs = std::vector<double>(width + 1),
+       ys = std::vector<double>(height + 1);
+  for (auto j = 0; j < width + 1; ++j) {
+    xs[j] = coord(0, j, 0);
+  }
+  for (auto i = 0; i < height + 1; ++i) {
+    ys[i] = coord(i, 0, 1);
+  }
+  for (auto i = 0; i < height + 1; ++i) {
+    for (auto j = 0; j < width + 1; ++j) {
+      if (coord(i, j, 0) != xs[j] || coord(i, j, 1) != ys[i]) {
+        return false;  // Also catches nans.
+      }
+    }
+  }
+  auto const& is_monotonic = [](std::vector<double> const& edges) -> bool {
+    auto const& increasing = edges.back() > edges.front();
+    for (size_t k = 0; k < edges.size() - 1; ++k) {
+      if (!std::isfinite(edges[k + 1])
+          || (increasing ? !(edges[k + 1] > edges[k])
+                         : !(edges[k + 1] < edges[k]))) {
+        return false;
+      }
+    }
+    return true;
+  };
+  if (!std::isfinite(xs[0]) || !std::isfinite(ys[0])
+      || !is_monotonic(xs) || !is_monotonic(ys)) {
+    return false;
+  }
+  auto cells = std::vector<uint32_t>(width * height);
+  auto const& fill_cells = [&]() -> void {
+    for (auto n = 0; n < width * height; ++n) {
+      auto const& [r, g, b, a] = fc(n);
+      // Round, as cairo does when premultiplying solid colors.
+      cells[n] =
+        (uint32_t(uint8_t(a * 255 + .5)) << 24)
+        | (uint32_t(uint8_t(r * a * 255 + .5)) << 16)
+        | (uint32_t(uint8_t(g * a * 255 + .5)) << 8)
+        | (uint32_t(uint8_t(b * a * 255 + .5)) << 0);
+    }
+  };
+  auto const& target = cairo_get_group_target(cr);
+  double tx = 0, ty = 0, x1 = 1, y1 = 0, x2 = 0, y2 = 1;
+  cairo_user_to_device(cr, &tx, &ty);
+  cairo_user_to_device(cr, &x1, &y1);
+  cairo_user_to_device(cr, &x2, &y2);
+  if (cairo_surface_get_type(target) == CAIRO_SURFACE_TYPE_IMAGE
+      && x1 - tx == 1 && y1 - ty == 0 && x2 - tx == 0 && y2 - ty == 1) {
+    // For each pixel in [p0, p0 + map.size()), the index of the interval of
+    // `edges` containing its center.
+    auto const& pixel_map = [](
+      std::vector<double> const& edges, double offset, int size)
+      -> std::tuple<int, std::vector<ssize_t>> {
+      auto const& increasing = edges.back() > edges.front();
+      auto const& lo = std::min(edges.front(), edges.back()) + offset,
+                & hi = std::max(edges.front(), edges.back()) + offset;
+      auto const& p0 = int(std::clamp(std::ceil(lo - .5), 0., double(size))),
+                & p1 = int(std::clamp(std::ceil(hi - .5), 0., double(size)));
+      auto map = std::vector<ssize_t>{};
+      map.reserve(std::max(p1 - p0, 0));
+      for (auto p = p0; p < p1; ++p) {
+        auto const& u = p + .5 - offset;
+        auto const& it =
+          increasing
+          ? std::upper_bound(edges.begin(), edges.end(), u)
+          : std::upper_bound(edges.begin(), edges.end(), u, std::greater<>{});
+        map.push_back(
+          std::clamp<ssize_t>(
+            it - edges.begin() - 1, 0, ssize_t(edges.size()) - 2));
+      }
+      return {p0, map};
+    };
+    auto const& [c0, col_map] =
+      pixel_map(xs, tx, cairo_image_surface_get_width(target));
+    auto const& [r0, row_map] =
+      pixel_map(ys, ty, cairo_image_surface_get_height(target));
+    if (col_map.empty() || row_map.empty()) {
+      return true;  // Nothing visible.
+    }
+    fill_cells();
+    auto const& image =
+      cairo_image_surface_create(
+        CAIRO_FORMAT_ARGB32, int(col_map.size()), int(row_map.size()));
+    auto const& data = cairo_image_surface_get_data(image);
+    auto const& stride = cairo_image_surface_get_stride(image);
+    cairo_surface_flush(image);
+    for (size_t r = 0; r < row_map.size(); ++r) {
+      auto const& row = cells.data() + row_map[r] * width;
+      auto const& out = reinterpret_cast<uint32_t*>(data + r * stride);
+      for (size_t c = 0; c < col_map.size(); ++c) {
+        out[c] = row[col_map[c]];
+      }
+    }
+    cairo_surface_mark_dirty(image);
+    cairo_save(cr);
+    cairo_identity_matrix(cr);
+    cairo_set_source_surface(cr, image, c0, r0);
+    cairo_surface_destroy(image);
+    cairo_paint(cr);
+    cairo_restore(cr);
+    return true;
+  }
+  auto const& is_uniform = [](std::vector<double> const& edges) -> bool {
+    auto const& step = (edges.back() - edges.front()) / (edges.size() - 1);
+    for (size_t k = 0; k < edges.size() - 1; ++k) {
+      if (std::abs(edges[k + 1] - edges[k] - step) > 1e-6 * std::abs(step)) {
+        return false;
+      }
+    }
+    return true;
+  };
+  if (!is_uniform(xs) || !is_uniform(ys)) {
+    return false;
+  }
+  fill_cells();
+  // Let cairo manage the surface memory, as some backends only write the
+  // image at flush time.
+  auto const& image =
+    cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+  auto const& data = cairo_image_surface_get_data(image);
+  auto const& stride = cairo_image_surface_get_stride(image);
+  cairo_surface_flush(image);
+  for (auto i = 0; i < height; ++i) {
+    std::copy_n(
+      cells.data() + i * width, width,
+      reinterpret_cast<uint32_t*>(data + i * stride));
+  }
+  cairo_surface_mark_dirty(image);
+  auto const& pattern = cairo_pattern_create_for_surface(image);
+  cairo_surface_destroy(image);
+  auto const& dx = (xs.back() - xs.front()) / width,
+            & dy = (ys.back() - ys.front()) / height;
+  auto const& matrix =
+    cairo_matrix_t{1 / dx, 0, 0, 1 / dy, -xs.front() / dx, -ys.front() / dy};
+  cairo_pattern_set_matrix(pattern, &matrix);
+  cairo_pattern_set_filter(pattern, CAIRO_FILTER_NEAREST);
+  cairo_save(cr);
+  cairo_set_source(cr, pattern);
+  cairo_pattern_destroy(pattern);
+  cairo_rectangle(
+    cr, xs.front(), ys.front(), xs.back() - xs.front(), ys.back() - ys.front());
+  cairo_fill(cr);
+  cairo_restore(cr);
+  return true;
+}
+
 py::array image_surface_to_buffer(cairo_surface_t* surface) {
   if (auto const& type = cairo_surface_get_type(surface);
       type != CAIRO_SURFACE_TYPE_IMAGE) {
@@ -565,32 +1417,246 @@ py::array image_surface_to_buffer(cairo_surface_t* surface) {
   }
 }
 
-cairo_font_face_t* font_face_from_path(std::string path)
+// Pixel conversion kernels, converting `n` pixels from `in` to `out` (which
+// may alias `in`).  The loops are branchless, so that compilers vectorize
+// them.  ARGB32 pixels are native-endian uint32s; RGBA8888 pixels are bytes in
+// that order; RGBA128F pixels are float32s, in that order.
+
+// floor(x / 255), for 0 <= x <= 255 * 255.
+uint32_t div255(uint32_t x)
+{
+  return (x + 1 + (x >> 8)) >> 8;
+}
+
+void premultiply_rgba8888(uint8_t const* in, uint8_t* out, ssize_t n)
+{
+  auto const& out32 = reinterpret_cast<uint32_t*>(out);
+  for (auto i = 0; i < n; ++i) {
+    uint32_t const r = in[4 * i], g = in[4 * i + 1], b = in[4 * i + 2],
+                   a = in[4 * i + 3];
+    out32[i] =
+      (a << 24) | (div255(a * r) << 16) | (div255(a * g) << 8)
+      | (div255(a * b) << 0);
+  }
+}
+
+void argb32_to_premultiplied_rgba8888(
+  uint8_t const* in, uint8_t* out, ssize_t n)
+{
+  auto const& in32 = reinterpret_cast<uint32_t const*>(in);
+  for (auto i = 0; i < n; ++i) {
+    auto const argb32 = in32[i];
+    out[4 * i] = argb32 >> 16;
+    out[4 * i + 1] = argb32 >> 8;
+    out[4 * i + 2] = argb32 >> 0;
+    out[4 * i + 3] = argb32 >> 24;
+  }
+}
+
+void argb32_to_straight_rgba8888(uint8_t const* in, uint8_t* out, ssize_t n)
+{
+  // The straightening formula, (c * 255 + a / 2) / a in integers, is from
+  // cairo-png.c.  Integer division does not vectorize, so the quotient is
+  // first estimated by multiplying with the (rounded) reciprocal of a, which
+  // is off by one for some (c, a) pairs (e.g., c=25, a=61), and then
+  // corrected in integers; this matches the exact formula for all 0 <= c < 256
+  // and 0 < a < 256.  Fully transparent pixels are mapped to zero.
+  auto const& in32 = reinterpret_cast<uint32_t const*>(in);
+  for (auto i = 0; i < n; ++i) {
+    auto const argb32 = in32[i];
+    uint32_t const a = argb32 >> 24, r = (argb32 >> 16) & 0xff,
+                   g = (argb32 >> 8) & 0xff, b = argb32 & 0xff;
+    auto const inv_a = a ? 1.f / a : 0.f;
+    auto const straighten = [&](uint32_t c) -> uint32_t {
+      if (!a) {
+        return 0;
+      }
+      auto const num = c * 0xff + a / 2;
+      auto q = uint32_t(num * inv_a);
+      q += (q + 1) * a <= num;
+      q -= q * a > num;
+      return q;
+    };
+    out[4 * i] = straighten(r);
+    out[4 * i + 1] = straighten(g);
+    out[4 * i + 2] = straighten(b);
+    out[4 * i + 3] = a;
+  }
+}
+
+void rgba128f_to_premultiplied_argb32(
+  uint8_t const* in, uint8_t* out, ssize_t n)
+{
+  auto const& inf = reinterpret_cast<float const*>(in);
+  auto const& out32 = reinterpret_cast<uint32_t*>(out);
+  for (auto i = 0; i < n; ++i) {
+    auto const r = inf[4 * i], g = inf[4 * i + 1], b = inf[4 * i + 2],
+               a = inf[4 * i + 3];
+    out32[i] =
+      (uint32_t(uint8_t(a * 255 + .5f)) << 24)
+      | (uint32_t(uint8_t(r * a * 255 + .5f)) << 16)
+      | (uint32_t(uint8_t(g * a * 255 + .5f)) << 8)
+      | (uint32_t(uint8_t(b * a * 255 + .5f)) << 0);
+  }
+}
+
+void rgba128f_to_premultiplied_rgba8888(
+  uint8_t const* in, uint8_t* out, ssize_t n)
+{
+  auto const& inf = reinterpret_cast<float const*>(in);
+  for (auto i = 0; i < n; ++i) {
+    auto const a = inf[4 * i + 3];
+    out[4 * i] = uint8_t(inf[4 * i] * a * 255 + .5f);
+    out[4 * i + 1] = uint8_t(inf[4 * i + 1] * a * 255 + .5f);
+    out[4 * i + 2] = uint8_t(inf[4 * i + 2] * a * 255 + .5f);
+    out[4 * i + 3] = uint8_t(a * 255 + .5f);
+  }
+}
+
+void rgba128f_to_straight_rgba8888(uint8_t const* in, uint8_t* out, ssize_t n)
+{
+  auto const& inf = reinterpret_cast<float const*>(in);
+  for (auto i = 0; i < 4 * n; ++i) {
+    out[i] = uint8_t(inf[i] * 255 + .5f);
+  }
+}
+
+// Convert a (height, width, 4) buffer from cairo's ARGB32 (uint8) or RGBA128F
+// (float32) format to `target` (PremultipliedARGB32, PremultipliedRGBA8888,
+// or StraightRGBA8888), writing to `out` if given (which must be a (height,
+// width, 4) uint8 array, and may be `buf` itself).  The rows are split over
+// `n_threads` threads, if nonzero.
+py::array_t<uint8_t> convert_cairo_buffer(
+  py::array buf, PixelFormat target,
+  std::optional<py::array_t<uint8_t>> out, int n_threads)
 {
-  auto& font_face = detail::FONT_CACHE[path];
-  if (font_face) {
-    cairo_font_face_reference(font_face);
+  using kernel_t = void (*)(uint8_t const*, uint8_t*, ssize_t);
+  if (buf.ndim() != 3 || buf.shape(2) != 4) {
+    throw std::invalid_argument{
+      "buffer must have shape (m, n, 4), not {.shape}"_format(buf)
+      .cast<std::string>()};
+  }
+  auto kernel = kernel_t{};
+  if (py::isinstance<py::array_t<uint8_t>>(buf)) {
+    switch (target) {
+      case PixelFormat::PremultipliedARGB32:
+        kernel = nullptr;  // Plain copy.
+        break;
+      case PixelFormat::PremultipliedRGBA8888:
+        kernel = argb32_to_premultiplied_rgba8888;
+        break;
+      case PixelFormat::StraightRGBA8888:
+        kernel = argb32_to_straight_rgba8888;
+        break;
+    }
+  } else if (py::isinstance<py::array_t<float>>(buf)) {
+    switch (target) {
+      case PixelFormat::PremultipliedARGB32:
+        kernel = rgba128f_to_premultiplied_argb32;
+        break;
+      case PixelFormat::PremultipliedRGBA8888:
+        kernel = rgba128f_to_premultiplied_rgba8888;
+        break;
+      case PixelFormat::StraightRGBA8888:
+        kernel = rgba128f_to_straight_rgba8888;
+        break;
+    }
   } else {
-    auto face_index = 0;
-    if (auto match = std::smatch{};
-        std::regex_match(path, match, std::regex{"(.*)#(\\d+)"})) {
-      path = match[1];
-      face_index = std::stoi(match[2]);
-    }
-    FT_Face ft_face;
-    FT_CHECK(
-      FT_New_Face, detail::ft_library, path.c_str(), face_index, &ft_face);
-    font_face =
-      cairo_ft_font_face_create_for_ft_face(ft_face, get_hinting_flag());
-    CAIRO_CLEANUP_CHECK(
-      { cairo_font_face_destroy(font_face); FT_Done_Face(ft_face); },
-      cairo_font_face_set_user_data,
-      font_face, &detail::FT_KEY, ft_face,
-      [](void* ptr) -> void {
-        FT_CHECK(FT_Done_Face, reinterpret_cast<FT_Face>(ptr));
-      });
+    throw std::invalid_argument{
+      "unexpected dtype: {}"_format(buf.dtype()).cast<std::string>()};
   }
-  return font_face;
+  if (!kernel && !out) {
+    return buf.cast<py::array_t<uint8_t>>();
+  }
+  auto const& height = buf.shape(0), width = buf.shape(1);
+  auto const& itemsize = buf.itemsize();
+  // The kernels require pixels to be contiguous within each row.
+  if (buf.strides(2) != itemsize || buf.strides(1) != 4 * itemsize) {
+    buf =
+      py::module::import("numpy").attr("ascontiguousarray")(buf)
+      .cast<py::array>();
+  }
+  if (!out) {
+    out = py::array_t<uint8_t>{{height, width, ssize_t{4}}};
+  } else if (out->ndim() != 3
+             || out->shape(0) != height || out->shape(1) != width
+             || out->shape(2) != 4
+             || out->strides(2) != 1 || out->strides(1) != 4) {
+    throw std::invalid_argument{
+      "output must be a (m, n, 4) array with contiguous pixels, matching the "
+      "input shape {.shape}, not {.shape}"_format(buf, *out)
+      .cast<std::string>()};
+  }
+  auto const& in_data = static_cast<uint8_t const*>(buf.data());
+  auto const& in_stride = buf.strides(0);
+  auto const& out_data = out->mutable_data();
+  auto const& out_stride = out->strides(0);
+  auto const& convert = [&](ssize_t start, ssize_t stop) -> void {
+    for (auto i = start; i < stop; ++i) {
+      if (kernel) {
+        kernel(in_data + i * in_stride, out_data + i * out_stride, width);
+      } else if (in_data + i * in_stride != out_data + i * out_stride) {
+        std::memcpy(out_data + i * out_stride, in_data + i * in_stride,
+                    4 * width);
+      }
+    }
+  };
+  auto const& nogil = ReleaseGIL{};
+  if (n_threads > 1 && height > 1) {
+    auto const& chunk_size = (height + n_threads - 1) / n_threads;
+    auto threads = std::vector<std::thread>{};
+    for (auto start = ssize_t{0}; start < height; start += chunk_size) {
+      threads.emplace_back(
+        convert, start, std::min(start + chunk_size, height));
+    }
+    for (auto& thread: threads) {
+      thread.join();
+    }
+  } else {
+    convert(0, height);
+  }
+  return *out;
+}
+
+void clear_font_cache()
+{
+  for (auto const& [path, font_face]: detail::FONT_CACHE) {
+    (void)path;
+    cairo_font_face_destroy(font_face);
+  }
+  detail::FONT_CACHE.clear();
+}
+
+cairo_font_face_t* font_face_from_path(std::string path)
+{
+  if (auto const& it = detail::FONT_CACHE.find(path);
+      it != detail::FONT_CACHE.end()) {
+    return cairo_font_face_reference(it->second);
+  }
+  // Must be retrieved before inserting into FONT_CACHE, which this can clear.
+  auto const& hinting_flag = get_hinting_flag();
+  auto file = path;
+  auto face_index = 0;
+  if (auto match = std::smatch{};
+      std::regex_match(path, match, std::regex{"(.*)#(\\d+)"})) {
+    file = match[1];
+    face_index = std::stoi(match[2]);
+  }
+  FT_Face ft_face;
+  FT_CHECK(
+    FT_New_Face, detail::ft_library, file.c_str(), face_index, &ft_face);
+  auto const& font_face =
+    cairo_ft_font_face_create_for_ft_face(ft_face, hinting_flag);
+  CAIRO_CLEANUP_CHECK(
+    { cairo_font_face_destroy(font_face); FT_Done_Face(ft_face); },
+    cairo_font_face_set_user_data,
+    font_face, &detail::FT_KEY, ft_face,
+    [](void* ptr) -> void {
+      FT_CHECK(FT_Done_Face, reinterpret_cast<FT_Face>(ptr));
+    });
+  // One reference for the cache, one for the caller.
+  detail::FONT_CACHE.emplace(path, font_face);
+  return cairo_font_face_reference(font_face);
 }
 
 cairo_font_face_t* font_face_from_path(py::object path) {
@@ -604,32 +1670,103 @@ cairo_font_face_t* font_face_from_path(py::object path) {
       .cast<std::string>());
 }
 
-cairo_font_face_t* font_face_from_prop(py::object prop)
+namespace {
+
+// Hash and equality of Python objects, for use as C++ map keys.
+struct PyObjectHash {
+  size_t operator()(py::object const& obj) const
+  {
+    return py::hash(obj);
+  }
+};
+
+struct PyObjectEqualTo {
+  bool operator()(py::object const& lhs, py::object const& rhs) const
+  {
+    return lhs.equal(rhs);
+  }
+};
+
+// Font-related state derived from rcParams: resolved font faces (keyed by
+// font_prop_key), the hinting flag and the font options.  Everything gets
+// recomputed whenever one of the rcParams that can affect it changes.
+struct FontState {
+  static constexpr char const* RC_KEYS[] = {
+    "font.family", "font.style", "font.variant", "font.weight",
+    "font.stretch", "font.size", "font.serif", "font.sans-serif",
+    "font.cursive", "font.fantasy", "font.monospace",
+    "text.hinting", "text.hinting_factor", "text.antialiased"};
+  static constexpr size_t MAX_FACES = 1024;  // NOTE: Arbitrary limit.
+
+  py::object rc_params;
+  std::vector<py::object> rc_snapshot;
+  std::unordered_map<
+    py::object, cairo_font_face_t*,  // Referenced.
+    PyObjectHash, PyObjectEqualTo> faces;
+  long hinting_flag{-1};
+  std::unique_ptr<cairo_font_options_t, decltype(&cairo_font_options_destroy)>
+    options{nullptr, cairo_font_options_destroy};
+
+  void clear_faces();
+  bool is_current();
+  void update();
+};
+
+void FontState::clear_faces()
 {
-  // It is probably not worth implementing an additional layer of caching here
-  // as findfont already has its cache and object equality needs would also
-  // need to go through Python anyways.
-  auto const& path =
-    py::module::import("matplotlib.font_manager").attr("findfont")(prop);
-  return font_face_from_path(path);
+  for (auto const& [key, font_face]: faces) {
+    (void)key;
+    cairo_font_face_destroy(font_face);
+  }
+  faces.clear();
 }
 
-long get_hinting_flag()
+// Whether the snapshot matches the current rcParams.  RcParams is a dict
+// subclass, so the values are read directly, skipping its (validating and
+// deprecation-checking) __getitem__.
+bool FontState::is_current()
 {
-  // FIXME[matplotlib]: Should be moved out of backend_agg.
-  return
-    py::module::import("matplotlib.backends.backend_agg")
-    .attr("get_hinting_flag")().cast<long>();
+  if (rc_snapshot.empty()) {
+    return false;
+  }
+  for (size_t i = 0; i < std::size(RC_KEYS); ++i) {
+    auto const& value =
+      PyDict_Check(rc_params.ptr())
+      ? py::reinterpret_borrow<py::object>(
+          PyDict_GetItemString(rc_params.ptr(), RC_KEYS[i]))
+      : py::object{rc_params[RC_KEYS[i]]};
+    if (!value || !value.equal(rc_snapshot[i])) {
+      return false;
+    }
+  }
+  return true;
 }
 
-std::unique_ptr<cairo_font_options_t, decltype(&cairo_font_options_destroy)>
-  get_font_options()
+void FontState::update()
 {
-  auto const& options = cairo_font_options_create();
+  rc_snapshot.clear();
+  for (auto const& key: RC_KEYS) {
+    auto value = py::object{rc_params[key]};
+    // Copy lists, which may be mutated in place.
+    if (py::isinstance<py::list>(value)) {
+      value = py::list{value};
+    }
+    rc_snapshot.push_back(value);
+  }
+  clear_faces();
+  // FIXME[matplotlib]: Should be moved out of backend_agg.
+  auto const& old_hinting_flag = hinting_flag;
+  hinting_flag =
+    py::module::import("matplotlib.backends.backend_agg")
+    .attr("get_hinting_flag")().cast<long>();
+  if (hinting_flag != old_hinting_flag) {
+    clear_font_cache();  // The hinting flag is set when creating a face.
+  }
+  options.reset(cairo_font_options_create());
   cairo_font_options_set_antialias(
-    options,
-    []() -> cairo_antialias_t {
-      auto aa = rc_param("text.antialiased");
+    options.get(),
+    [&]() -> cairo_antialias_t {
+      auto aa = py::object{rc_params["text.antialiased"]};
       try {
         return aa.cast<cairo_antialias_t>();
       } catch (py::cast_error&) {
@@ -637,7 +1774,70 @@ std::unique_ptr<cairo_font_options_t, decltype(&cairo_font_options_destroy)>
           aa.cast<bool>() ? CAIRO_ANTIALIAS_SUBPIXEL : CAIRO_ANTIALIAS_NONE;
       }
     }());
-  return {options, cairo_font_options_destroy};
+}
+
+FontState& get_font_state()
+{
+  // Intentionally leaked, so that no cairo/FreeType cleanup runs at
+  // interpreter shutdown.
+  static auto& state = *new FontState{};
+  if (!state.rc_params) {
+    state.rc_params = py::module::import("matplotlib").attr("rcParams");
+  }
+  if (!state.is_current()) {
+    state.update();
+  }
+  return state;
+}
+
+}
+
+// A tuple of the fields of FontProperties `prop`, to be used as a cache key.
+// FontProperties.__eq__ only compares hashes, so distinct properties with
+// colliding hashes would compare equal; the tuple compares by value instead
+// (and is unaffected by later mutations of `prop`).
+py::object font_prop_key(py::object prop)
+{
+  return py::make_tuple(
+    py::tuple{prop.attr("get_family")()}, prop.attr("get_style")(),
+    prop.attr("get_variant")(), prop.attr("get_weight")(),
+    prop.attr("get_stretch")(), prop.attr("get_size")(),
+    prop.attr("get_file")(),
+    // Matplotlib>=3.4.
+    py::hasattr(prop, "get_math_fontfamily")
+    ? prop.attr("get_math_fontfamily")() : py::object{py::none{}});
+}
+
+cairo_font_face_t* font_face_from_prop(py::object prop)
+{
+  auto& state = get_font_state();
+  auto const& key = font_prop_key(prop);
+  if (auto const& it = state.faces.find(key); it != state.faces.end()) {
+    record_stat("font_cache.hit");
+    return cairo_font_face_reference(it->second);
+  }
+  auto const& timed = Timed{"findfont"};
+  auto const& path =
+    py::module::import("matplotlib.font_manager").attr("findfont")(prop);
+  auto const& font_face = font_face_from_path(path);
+  if (state.faces.size() >= FontState::MAX_FACES) {
+    state.clear_faces();  // Naive cache mechanism.
+  }
+  state.faces.emplace(key, cairo_font_face_reference(font_face));
+  return font_face;
+}
+
+long get_hinting_flag()
+{
+  return get_font_state().hinting_flag;
+}
+
+std::unique_ptr<cairo_font_options_t, decltype(&cairo_font_options_destroy)>
+  get_font_options()
+{
+  return {
+    cairo_font_options_copy(get_font_state().options.get()),
+    cairo_font_options_destroy};
 }
 
 void warn_on_missing_glyph(std::string s) {
@@ -649,8 +1849,30 @@ void warn_on_missing_glyph(std::string s) {
     1);
 }
 
+// Warn for each glyph of `gac` (shaped from `s`) missing from the font.
+void warn_on_missing_glyphs(GlyphsAndClusters const& gac, std::string const& s)
+{
+  auto bytes_pos = 0, glyphs_pos = 0;
+  for (auto i = 0; i < gac.num_clusters; ++i) {
+    auto const& cluster = gac.clusters[i];
+    auto const& next_bytes_pos = bytes_pos + cluster.num_bytes,
+                next_glyphs_pos = glyphs_pos + cluster.num_glyphs;
+    for (auto j = glyphs_pos; j < next_glyphs_pos; ++j) {
+      if (!gac.glyphs[j].index) {
+        auto missing =
+          py::cast(s.substr(bytes_pos, cluster.num_bytes))
+          .attr("encode")("ascii", "namereplace");
+        warn_on_missing_glyph(missing.cast<std::string>());
+      }
+    }
+    bytes_pos = next_bytes_pos;
+    glyphs_pos = next_glyphs_pos;
+  }
+}
+
 GlyphsAndClusters text_to_glyphs_and_clusters(cairo_t* cr, std::string s)
 {
+  auto const& timed = Timed{"text_to_glyphs_and_clusters", s.size()};
   auto const& scaled_font = cairo_get_scaled_font(cr);
   auto gac = GlyphsAndClusters{};
   if (has_raqm()) {
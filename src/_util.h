@@ -9,6 +9,9 @@
 #include <pybind11/numpy.h>
 #include <pybind11/stl.h>
 
+#include <chrono>
+#include <map>
+
 // Helper for std::visit.
 template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
 template<class... Ts> overloaded(Ts...) -> overloaded<Ts...>;
@@ -66,26 +69,43 @@ extern void (*cairo_ps_surface_dsc_comment)(cairo_surface_t*, char const*);
   _(cairo_ps_surface_dsc_comment)
 
 // Other useful values.
+// Font faces by path (referenced).
 extern std::unordered_map<std::string, cairo_font_face_t*> FONT_CACHE;
 extern cairo_user_data_key_t const
-  REFS_KEY,  // cairo_t -> kept alive Python objects.
+  REFS_KEY,  // cairo_t or cairo_surface_t -> kept alive Python objects.
   STATE_KEY, // cairo_t -> additional state.
-  FT_KEY;    // cairo_font_face_t -> FT_Face.
+  FT_KEY,    // cairo_font_face_t -> FT_Face.
+  WRITER_KEY;  // cairo_surface_t or cairo_device_t -> StreamWriter.
 extern py::object UNIT_CIRCLE;
 extern py::object PIXEL_MARKER;
 extern bool FLOAT_SURFACE;
+extern bool GLYPH_ATLAS;
+extern size_t LAYOUT_CACHE_SIZE;
 extern int MARKER_THREADS;
 extern double MITER_LIMIT;
+extern bool PATH_DECIMATION;
+extern size_t PATTERN_CACHE_BYTES;
+extern bool PROFILE;
+extern bool RELEASE_GIL;
+extern size_t SURFACE_POOL_BYTES;
 enum class MplcairoScriptSurface {
   None, Raster, Vector
 };
 extern MplcairoScriptSurface MPLCAIRO_SCRIPT_SURFACE;
 }
 
+// Memory that per-thread scratch buffers (and recycled stamp surfaces) may
+// hold on to between calls.
+constexpr auto SCRATCH_BYTES = size_t{1} << 24;  // NOTE: Arbitrary limit.
+
 using rectangle_t = std::tuple<double, double, double, double>;
 using rgb_t = std::tuple<double, double, double>;
 using rgba_t = std::tuple<double, double, double, double>;
 
+enum class PixelFormat {
+  PremultipliedARGB32, PremultipliedRGBA8888, StraightRGBA8888
+};
+
 enum class PathCode {
   STOP = 0, MOVETO = 1, LINETO = 2, CURVE3 = 3, CURVE4 = 4, CLOSEPOLY = 79
 };
@@ -112,6 +132,101 @@ struct AdditionalState {
   double get_hatch_linewidth();
 };
 
+// Releases the GIL for its lifetime, if the release_gil option is set.  Only
+// wrap calls that never touch Python objects (the write callbacks of stream
+// surfaces reacquire the GIL themselves).
+class ReleaseGIL {
+  std::optional<py::gil_scoped_release> release_;
+
+  public:
+  ReleaseGIL();
+};
+
+// Output buffer for stream surfaces.  cairo emits many small writes; these are
+// collected and passed on in large blocks, either to the file's write method
+// or, for plain files, directly to the underlying file descriptor (not
+// touching the interpreter at all).  Errors are recorded and reraised by
+// finish().
+class StreamWriter {
+  static constexpr size_t BLOCK_SIZE = 1 << 20;
+
+  py::object file_;
+  std::optional<int> fd_;
+  std::vector<unsigned char> buf_;
+  std::exception_ptr error_;
+  bool reported_{false};
+
+  void flush();
+
+  public:
+  StreamWriter(py::object file);
+  ~StreamWriter();
+
+  // cairo_write_func_t, with the StreamWriter as closure.
+  static cairo_status_t write(
+    void* closure, unsigned char const* data, unsigned int length);
+  // Flush the buffer and reraise any error from a previous write.
+  void finish();
+};
+
+// Profiling counters, accumulated per renderer while the profile option is set
+// (see GraphicsContextRenderer::_get_stats).  Timings are inclusive, e.g. the
+// time spent in load_path_exact is also counted in the calling draw_path.
+struct Stats {
+  struct Entry {
+    size_t calls, items;
+    double seconds;
+  };
+  // An ordered map, so that pointers to entries remain valid across
+  // insertions.
+  std::map<std::string, Entry> entries;
+};
+
+// Records a call to `name` (processing `items` items, e.g. vertices) and its
+// duration into the Stats of the renderer currently drawing on this thread;
+// a no-op unless the profile option is set.  Passing a Stats explicitly also
+// makes it current for the lifetime of the Timed, so that helpers called in
+// the meantime get attributed to it (helpers running in worker threads are
+// not recorded).
+class Timed {
+  Stats* prev_stats_;
+  Stats::Entry* entry_;
+  std::chrono::steady_clock::time_point start_;
+
+  Timed(Stats* stats, char const* name, size_t items);
+
+  public:
+  Timed(char const* name, size_t items=0);
+  Timed(Stats& stats, char const* name, size_t items=0);
+  ~Timed();
+  Timed(Timed const& other) = delete;
+  Timed& operator=(Timed const& other) = delete;
+
+  void add_items(size_t items);
+};
+
+// Records an (untimed) event, e.g. a cache hit, like Timed.
+void record_stat(char const* name, size_t items=0);
+
+// Sequential (forward) access to the vertices of an (n, 2) array, transformed
+// by a matrix; the vertices are transformed by fixed-size blocks, using
+// transform_vertices.
+class TransformedVertices {
+  static constexpr ssize_t BLOCK_SIZE = 1024;
+  py::detail::unchecked_reference<double, 2> vertices_;
+  cairo_matrix_t const* matrix_;
+  ssize_t start_, stop_;
+  double xys_[2 * BLOCK_SIZE];
+  bool finite_[BLOCK_SIZE];
+
+  public:
+  TransformedVertices(
+    py::detail::unchecked_reference<double, 2> const& vertices,
+    cairo_matrix_t const* matrix);
+  // Return the transformed x and y, and whether they are both finite.
+  std::tuple<double, double, bool> operator()(ssize_t i);
+};
+
 struct GlyphsAndClusters {
   cairo_glyph_t* glyphs{};
   int num_glyphs{};
@@ -122,32 +237,82 @@ struct GlyphsAndClusters {
   ~GlyphsAndClusters();
 };
 
+// The region outside of which drawing has no effect (i.e., for image surfaces,
+// the clip extents, in user space; elsewhere, everything), so that items whose
+// bounds do not intersect it can be skipped ("culled").
+struct Bounds {
+  double x0, y0, x1, y1;
+
+  bool intersects(double x0, double y0, double x1, double y1) const;
+};
+
 py::object operator""_format(char const* fmt, std::size_t size);
 bool py_eq(py::object obj1, py::object obj2);
 py::object rc_param(std::string key);
 cairo_format_t get_cairo_format();
 rgba_t to_rgba(py::object color, std::optional<double> alpha = {});
+py::array_t<double> to_rgba_array(
+  py::object colors, std::optional<double> alpha = {});
 cairo_matrix_t matrix_from_transform(py::object transform, double y0 = 0);
 cairo_matrix_t matrix_from_transform(
   py::object transform, cairo_matrix_t const* master_matrix);
 bool has_vector_surface(cairo_t* cr);
+Bounds get_cull_bounds(cairo_t* cr);
 AdditionalState& get_additional_state(cairo_t* cr);
+void transform_points(
+  cairo_matrix_t const* matrix, ssize_t n,
+  double const* xs, double const* ys, ssize_t stride,
+  double* out, bool* finite);
+void transform_vertices(
+  py::detail::unchecked_reference<double, 2> const& vertices,
+  ssize_t start, ssize_t stop, cairo_matrix_t const* matrix,
+  double* out, bool* finite);
 void load_path_exact(
   cairo_t* cr, py::object path, cairo_matrix_t const* matrix);
 void load_path_exact(
   cairo_t* cr, py::array_t<double> vertices, ssize_t start, ssize_t stop,
-  cairo_matrix_t const* matrix);
+  cairo_matrix_t const* matrix, bool decimate = false, bool cull = false);
 void fill_and_stroke_exact(
   cairo_t* cr, py::object path, cairo_matrix_t const* matrix,
   std::optional<rgba_t> fill, std::optional<rgba_t> stroke);
+void draw_threaded(
+  cairo_t* cr, int n_threads, ssize_t n,
+  std::function<std::tuple<double, double>(ssize_t)> const& rows,
+  std::function<void(cairo_t*, ssize_t)> const& draw);
+bool draw_banded(
+  cairo_t* cr, int n_threads, ssize_t n,
+  std::function<std::tuple<double, double>(ssize_t)> const& rows,
+  std::function<void(cairo_t*, std::vector<ssize_t> const&)> const& draw_band);
+void draw_chunked(
+  cairo_t* cr, int n_threads, ssize_t n,
+  std::function<void(cairo_t*, ssize_t)> const& draw);
+bool draw_rectilinear_mesh(
+  cairo_t* cr, ssize_t width, ssize_t height, double const* coords,
+  std::function<rgba_t(ssize_t)> const& fc);
 py::array image_surface_to_buffer(cairo_surface_t* surface);
+uint32_t div255(uint32_t x);
+void premultiply_rgba8888(uint8_t const* in, uint8_t* out, ssize_t n);
+void argb32_to_premultiplied_rgba8888(
+  uint8_t const* in, uint8_t* out, ssize_t n);
+void argb32_to_straight_rgba8888(uint8_t const* in, uint8_t* out, ssize_t n);
+void rgba128f_to_premultiplied_argb32(
+  uint8_t const* in, uint8_t* out, ssize_t n);
+void rgba128f_to_premultiplied_rgba8888(
+  uint8_t const* in, uint8_t* out, ssize_t n);
+void rgba128f_to_straight_rgba8888(uint8_t const* in, uint8_t* out, ssize_t n);
+py::array_t<uint8_t> convert_cairo_buffer(
+  py::array buf, PixelFormat target,
+  std::optional<py::array_t<uint8_t>> out = {}, int n_threads = 0);
+void clear_font_cache();
 cairo_font_face_t* font_face_from_path(std::string path);
 cairo_font_face_t* font_face_from_path(py::object path);
+py::object font_prop_key(py::object prop);
 cairo_font_face_t* font_face_from_prop(py::object prop);
 long get_hinting_flag();
 std::unique_ptr<cairo_font_options_t, decltype(&cairo_font_options_destroy)>
   get_font_options();
 void warn_on_missing_glyph(std::string s);
+void warn_on_missing_glyphs(GlyphsAndClusters const& gac, std::string const& s);
 GlyphsAndClusters text_to_glyphs_and_clusters(cairo_t* cr, std::string s);
 
 }
@@ -0,0 +1,64 @@
+import pytest
+
+import matplotlib as mpl
+from matplotlib import colors as mcolors
+from matplotlib.figure import Figure
+from matplotlib.image import AxesImage
+import numpy as np
+
+import mplcairo
+from mplcairo.base import FigureCanvasCairo
+from mplcairo.image import ColormappedImage
+
+
+@pytest.fixture(autouse=True)
+def rcdefaults():
+    mpl.rcdefaults()
+    options = mplcairo.get_options()
+    yield
+    mplcairo.set_options(**options)
+
+
+def _invert(img, dpi):
+    img = img.copy()
+    img[..., :3] = 1 - img[..., :3]
+    return img, 0, 0
+
+
+def _draw(image_cls, data, **kwargs):
+    # Each data element covers exactly 10x10 pixels, so that "nearest"
+    # resampling is unambiguous.
+    rows, cols = data.shape
+    fig = Figure(figsize=(cols / 10, rows / 10), dpi=100)
+    ax = fig.add_axes([0, 0, 1, 1])
+    ax.set_axis_off()
+    im = image_cls(ax, cmap="viridis", interpolation="nearest", **kwargs)
+    im.set_data(data)
+    im.set_extent(im.get_extent())
+    ax.add_image(im)
+    canvas = FigureCanvasCairo(fig)
+    canvas.draw()
+    return canvas.get_renderer().buffer_rgba()
+
+
+@pytest.mark.parametrize("origin", ["upper", "lower"])
+@pytest.mark.parametrize("agg_filter", [None, _invert])
+@pytest.mark.parametrize("masked", [False, True])
+def test_matches_fallback(origin, agg_filter, masked):
+    data = np.random.RandomState(0).standard_normal((12, 16))
+    if masked:
+        data = np.ma.masked_greater(data, 1)
+    kwargs = {"origin": origin, "agg_filter": agg_filter}
+    native = _draw(ColormappedImage, data, **kwargs)
+    fallback = _draw(AxesImage, data, **kwargs)
+    # Allow for premultiplication and straightening roundoff.
+    np.testing.assert_allclose(
+        native.astype(int), fallback.astype(int), atol=1)
+
+
+def test_inverted_norm():
+    data = np.arange(12.).reshape((3, 4))
+    with pytest.raises(ValueError):
+        _draw(ColormappedImage, data, norm=mcolors.Normalize(1, 0))
+    with pytest.raises(ValueError):
+        _draw(AxesImage, data, norm=mcolors.Normalize(1, 0))
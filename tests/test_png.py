@@ -0,0 +1,99 @@
+import io
+import struct
+
+import numpy as np
+from PIL import Image
+import pytest
+
+import mplcairo
+from mplcairo import _util
+from mplcairo.base import GraphicsContextRendererCairo
+
+
+def test_straightening_matches_cairo_png():
+    cairo = pytest.importorskip("cairo")
+    # Every (c, a) premultiplied pair, with c <= a: alpha varies along rows,
+    # and the color components along columns.
+    a, c = np.mgrid[:256, :256].astype(np.uint32)
+    argb32 = (a << 24
+              | np.minimum(c, a) << 16
+              | np.minimum(255 - c, a) << 8
+              | np.minimum(c // 2, a))
+    renderer = _make_renderer(256, 256)
+    renderer._get_buffer().view(np.uint32)[..., 0] = argb32
+    native = io.BytesIO()
+    renderer._write_png(native, {}, (72, 72))
+    surface = cairo.ImageSurface.create_for_data(
+        memoryview(np.ascontiguousarray(argb32)),
+        cairo.FORMAT_ARGB32, 256, 256, 256 * 4)
+    reference = io.BytesIO()
+    surface.write_to_png(reference)
+    native.seek(0)
+    reference.seek(0)
+    np.testing.assert_array_equal(
+        np.asarray(Image.open(native).convert("RGBA")),
+        np.asarray(Image.open(reference).convert("RGBA")))
+    # The same kernel backs the straight RGBA8888 buffer conversions.
+    np.testing.assert_array_equal(
+        _util.cairo_to_straight_rgba8888(renderer._get_buffer()),
+        np.asarray(Image.open(reference).convert("RGBA")))
+
+
+def _make_renderer(width, height):
+    options = mplcairo.get_options()
+    mplcairo.set_options(float_surface=False)
+    try:
+        renderer = GraphicsContextRendererCairo(width, height, 72)
+    finally:
+        mplcairo.set_options(**options)
+    # Arbitrary, but valid (c <= a), premultiplied pixels.
+    a, c = np.random.RandomState(0).randint(0, 256, (2, height, width))
+    c = np.minimum(a, c).astype(np.uint32)
+    renderer._get_buffer().view(np.uint32)[..., 0] = (
+        a.astype(np.uint32) << 24 | c << 16 | (a - c).astype(np.uint32) << 8
+        | c // 2)
+    return renderer
+
+
+def _read_chunks(buf):
+    assert buf[:8] == b"\x89PNG\r\n\x1a\n"
+    chunks = []
+    pos = 8
+    while pos < len(buf):
+        size, = struct.unpack(">I", buf[pos:pos+4])
+        chunks.append((buf[pos+4:pos+8], buf[pos+8:pos+8+size]))
+        pos += 12 + size
+    return chunks
+
+
+@pytest.mark.parametrize(
+    "filter", ["none", "sub", "up", "average", "paeth", "adaptive"])
+def test_filters(filter):
+    renderer = _make_renderer(37, 23)
+    buf = io.BytesIO()
+    renderer._write_png(buf, {}, (72, 72), filter=filter)
+    buf.seek(0)
+    np.testing.assert_array_equal(
+        np.asarray(Image.open(buf)),
+        _util.cairo_to_straight_rgba8888(renderer._get_buffer()))
+
+
+def test_invalid_filter():
+    renderer = _make_renderer(1, 1)
+    with pytest.raises(ValueError):
+        renderer._write_png(io.BytesIO(), {}, (72, 72), filter="foo")
+
+
+def test_metadata():
+    renderer = _make_renderer(1, 1)
+    buf = io.BytesIO()
+    renderer._write_png(
+        buf, {"Title": "caf\xe9", "Author": "\u2603", "Description": None},
+        (72, 72))
+    chunks = _read_chunks(buf.getvalue())
+    assert [type for type, _ in chunks] == [
+        b"IHDR", b"pHYs", b"tEXt", b"iTXt", b"IDAT", b"IEND"]
+    assert chunks[2][1] == b"Title\0caf\xe9"
+    assert chunks[3][1] == b"Author\0\0\0\0\0" + "\u2603".encode("utf-8")
+    buf.seek(0)
+    assert Image.open(buf).text == {"Title": "caf\xe9", "Author": "\u2603"}
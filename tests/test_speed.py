@@ -1,15 +1,21 @@
+import io
 import multiprocessing
+import os
 
 import pytest
 
 import matplotlib as mpl
 from matplotlib.figure import Figure
+from matplotlib.font_manager import FontProperties
+from matplotlib.markers import MarkerStyle
+from matplotlib.path import Path
+from matplotlib.transforms import Affine2D, IdentityTransform
 import numpy as np
 
 from matplotlib.backends.backend_agg import FigureCanvasAgg
 import mplcairo
 from mplcairo import antialias_t
-from mplcairo.base import FigureCanvasCairo
+from mplcairo.base import FigureCanvasCairo, GraphicsContextRendererCairo
 
 # Import an autouse fixture.
 from matplotlib.testing.conftest import mpl_test_settings
@@ -145,3 +151,141 @@ def test_image(benchmark, canvas_cls, axes, sample_image):
     despine(axes)
     axes.figure.canvas = canvas_cls(axes.figure)
     benchmark(axes.figure.canvas.draw)
+
+
+# Renderer-level benchmarks, which call the draw_* methods directly on
+# synthetic data (bypassing the artist layer) so that mostly native time is
+# measured.  The per-operation statistics of the profile option are attached
+# to each result, so that ``--benchmark-json`` (and ``--benchmark-compare``)
+# also record where the time went.
+
+
+@pytest.fixture
+def renderer(benchmark):
+    mpl.rcdefaults()
+    options = mplcairo.get_options()
+    mplcairo.set_options(profile=True, raqm=False)
+    renderer = GraphicsContextRendererCairo(800, 600, 100)
+    yield renderer
+    benchmark.extra_info["stats"] = renderer._get_stats()
+    mplcairo.set_options(**options)
+
+
+def _run(benchmark, renderer, draw, *, antialiased=antialias_t.FAST,
+         linewidth=1):
+    def run():
+        gc = renderer.new_gc()
+        gc.set_antialiased(antialiased)
+        gc.set_linewidth(linewidth)
+        gc.set_foreground("C0")
+        draw(gc)
+        gc.restore()
+    run()  # Warm up caches (and fail early), then reset the statistics.
+    renderer._get_stats(reset=True)
+    benchmark(run)
+
+
+_sizes = pytest.mark.parametrize("n", [1000, 100000])
+_antialias_modes = pytest.mark.parametrize(
+    "antialiased", [antialias_t.NONE, antialias_t.FAST, antialias_t.BEST])
+# Leave one CPU for the main thread, but still test a threaded run (and only
+# once) on single-CPU machines.
+_marker_threads = pytest.mark.parametrize(
+    "marker_threads", sorted({0, max(1, (os.cpu_count() or 1) - 1)}))
+_thresholds = pytest.mark.parametrize("threshold", [0, 1/8])
+
+
+@_sizes
+@_antialias_modes
+@_thresholds
+def test_renderer_draw_path(benchmark, renderer, n, antialiased, threshold):
+    path = Path(
+        np.column_stack([np.linspace(0, 800, n),
+                         np.random.RandomState(0).random_sample(n) * 600]))
+    with mpl.rc_context({"path.simplify_threshold": threshold}):
+        _run(benchmark, renderer,
+             lambda gc: renderer.draw_path(gc, path, IdentityTransform()),
+             antialiased=antialiased)
+
+
+@_sizes
+@_antialias_modes
+@_marker_threads
+@_thresholds
+def test_renderer_draw_markers(
+        benchmark, renderer, n, antialiased, marker_threads, threshold):
+    mplcairo.set_options(marker_threads=marker_threads)
+    path = Path(np.random.RandomState(0).random_sample((n, 2)) * [800, 600])
+    marker = MarkerStyle("o")
+    marker_transform = marker.get_transform() + Affine2D().scale(3)
+    with mpl.rc_context({"path.simplify_threshold": threshold}):
+        _run(benchmark, renderer,
+             lambda gc: renderer.draw_markers(
+                 gc, marker.get_path(), marker_transform,
+                 path, IdentityTransform(), (1, 0, 0, 1)),
+             antialiased=antialiased)
+
+
+@_sizes
+@_antialias_modes
+@_marker_threads
+@_thresholds
+def test_renderer_draw_path_collection(
+        benchmark, renderer, n, antialiased, marker_threads, threshold):
+    mplcairo.set_options(marker_threads=marker_threads)
+    rs = np.random.RandomState(0)
+    offsets = rs.random_sample((n, 2)) * [800, 600]
+    facecolors = rs.random_sample((n, 4))
+    marker = MarkerStyle("s")
+    with mpl.rc_context({"path.simplify_threshold": threshold}):
+        _run(benchmark, renderer,
+             lambda gc: renderer.draw_path_collection(
+                 gc, IdentityTransform(), [marker.get_path()],
+                 [Affine2D().scale(5).get_matrix()], offsets,
+                 IdentityTransform(), facecolors, [(0, 0, 0, 1)], [1],
+                 [(None, None)], [antialiased], [None], "screen"),
+             antialiased=antialiased)
+
+
+@pytest.mark.parametrize("n", [10, 300])
+@_antialias_modes
+@_marker_threads
+def test_renderer_draw_quad_mesh(
+        benchmark, renderer, n, antialiased, marker_threads):
+    mplcairo.set_options(marker_threads=marker_threads)
+    rs = np.random.RandomState(0)
+    xs, ys = np.meshgrid(
+        np.linspace(0, 800, n + 1), np.linspace(0, 600, n + 1))
+    coordinates = np.dstack([xs, ys])
+    facecolors = rs.random_sample((n * n, 4))
+    _run(benchmark, renderer,
+         lambda gc: renderer.draw_quad_mesh(
+             gc, IdentityTransform(), n, n, coordinates, np.zeros((1, 2)),
+             IdentityTransform(), facecolors, antialiased, np.zeros((0, 4))),
+         antialiased=antialiased)
+
+
+@pytest.mark.parametrize("n", [100, 600])
+def test_renderer_draw_image(benchmark, renderer, n):
+    im = (np.random.RandomState(0).random_sample((n, n, 4)) * 255).astype(
+        np.uint8)
+    _run(benchmark, renderer, lambda gc: renderer.draw_image(gc, 0, 0, im))
+
+
+@pytest.mark.parametrize("n", [10, 1000])
+@_antialias_modes
+def test_renderer_draw_text(benchmark, renderer, n, antialiased):
+    prop = FontProperties(size=10)
+
+    def draw(gc):
+        for i in range(n):
+            renderer.draw_text(gc, i % 800, i % 600, "Abc123", prop, 0)
+
+    _run(benchmark, renderer, draw, antialiased=antialiased)
+
+
+@pytest.mark.parametrize("fmt", ["png", "pdf", "ps", "svg"])
+def test_renderer_output(benchmark, axes, sample_vectors, fmt):
+    axes.plot(*sample_vectors, marker="o")
+    axes.figure.canvas = FigureCanvasCairo(axes.figure)
+    benchmark(lambda: axes.figure.savefig(io.BytesIO(), format=fmt))